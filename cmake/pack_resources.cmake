@@ -0,0 +1,88 @@
+# Pack a directory into one archive that the app maps into memory and serves as app://ui/..., see ResourcePack.
+#
+#   WUIPAK 1
+#   <offset> <size> <encoding> <path>     one line per file, encoding is identity or gzip
+#   <empty line>
+#   file contents back to back, offsets count from the first byte after the empty line
+#
+# include() it for pack_resources(), the packing itself runs as `cmake -P` at build time.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  file(GLOB_RECURSE _files LIST_DIRECTORIES false RELATIVE "${PACK_SOURCE}" "${PACK_SOURCE}/*")
+  list(SORT _files)
+
+  file(MAKE_DIRECTORY "${PACK_WORK_DIR}")
+
+  set(_index "WUIPAK 1\n")
+  set(_blobs "")
+  set(_offset 0)
+  foreach(_file ${_files})
+    set(_blob "${PACK_SOURCE}/${_file}")
+    set(_encoding identity)
+
+    # text compresses well and is what the page loads first, images and fonts are compressed already
+    if(PACK_GZIP AND _file MATCHES "\\.(html|htm|js|mjs|css|json|svg|txt)$")
+      string(MAKE_C_IDENTIFIER "${_file}" _name)
+      set(_compressed "${PACK_WORK_DIR}/${_name}.gz")
+      execute_process(COMMAND "${PACK_GZIP}" -9 -n -c "${_blob}" OUTPUT_FILE "${_compressed}" RESULT_VARIABLE _result)
+
+      file(SIZE "${_blob}" _plain_size)
+      file(SIZE "${_compressed}" _compressed_size)
+      if(_result EQUAL 0 AND _compressed_size LESS _plain_size)
+        set(_blob "${_compressed}")
+        set(_encoding gzip)
+      endif()
+    endif()
+
+    file(SIZE "${_blob}" _size)
+    string(APPEND _index "${_offset} ${_size} ${_encoding} ${_file}\n")
+    list(APPEND _blobs "${_blob}")
+    math(EXPR _offset "${_offset} + ${_size}")
+  endforeach()
+  string(APPEND _index "\n")
+
+  file(WRITE "${PACK_WORK_DIR}/index" "${_index}")
+  execute_process(COMMAND "${CMAKE_COMMAND}" -E cat "${PACK_WORK_DIR}/index" ${_blobs}
+                  OUTPUT_FILE "${PACK_OUTPUT}" RESULT_VARIABLE _result)
+  if(NOT _result EQUAL 0)
+    message(FATAL_ERROR "Packing ${PACK_SOURCE} into ${PACK_OUTPUT} failed")
+  endif()
+
+  list(LENGTH _files _count)
+  message(STATUS "Packed ${_count} files from ${PACK_SOURCE} into ${PACK_OUTPUT}")
+  return()
+endif()
+
+option(WUI_PACK_GZIP "Store text assets of the resource pack gzip compressed" OFF)
+
+set(_PACK_RESOURCES_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+# Rebuilds `output` from everything below `srcDir` whenever a file there changes, before `target` is built.
+macro(pack_resources target srcDir output)
+  file(GLOB_RECURSE _pack_inputs LIST_DIRECTORIES false CONFIGURE_DEPENDS "${srcDir}/*")
+
+  set(_pack_gzip "")
+  if(WUI_PACK_GZIP)
+    find_program(WUI_GZIP_EXECUTABLE gzip)
+    if(WUI_GZIP_EXECUTABLE)
+      set(_pack_gzip "${WUI_GZIP_EXECUTABLE}")
+    else()
+      message(WARNING "WUI_PACK_GZIP is on but gzip was not found, packing uncompressed")
+    endif()
+  endif()
+
+  add_custom_command(
+    OUTPUT "${output}"
+    COMMAND "${CMAKE_COMMAND}"
+            "-DPACK_SOURCE=${srcDir}"
+            "-DPACK_OUTPUT=${output}"
+            "-DPACK_WORK_DIR=${CMAKE_CURRENT_BINARY_DIR}/${target}_pack"
+            "-DPACK_GZIP=${_pack_gzip}"
+            -P "${_PACK_RESOURCES_SCRIPT}"
+    DEPENDS ${_pack_inputs} "${_PACK_RESOURCES_SCRIPT}"
+    COMMENT "Packing ${srcDir}"
+    VERBATIM
+    )
+  add_custom_target(${target}_pack DEPENDS "${output}")
+  add_dependencies(${target} ${target}_pack)
+endmacro(pack_resources)
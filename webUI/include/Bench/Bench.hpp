@@ -0,0 +1,21 @@
+#pragma once
+
+namespace WUI
+{
+    // Headless benchmark of the OSR pipeline: OnPaint -> convert -> upload -> al_draw_bitmap -> flip.
+    // Synthetic paints are fed straight into a RenderHandler that renders into a memory bitmap,
+    // so it runs without CEF, a desktop session or a gpu.
+    //
+    //   webUI --bench [--bench-size=WxH] [--bench-frames=N] [--bench-pattern=full|caret|counter|scatter]
+    //                 [--bench-paints-per-frame=X] [--bench-balls=N] [--bench-only=section,...] [--trace=file.json]
+    //
+    // Sections: kernels, balls, broadphase, parallel, input, bus, data, spawn, resources, startup, resize, popup, upload, pipeline.
+    namespace Bench
+    {
+        // true if the command line asks for the benchmark instead of the app
+        bool requested(int argc, char *argv[]);
+
+        // returns the process exit code, non zero if a pixel or physics kernel produced wrong output
+        int run(int argc, char *argv[]);
+    }
+}
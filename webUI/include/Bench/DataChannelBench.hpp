@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <include/cef_browser.h>
+
+#include "Bench/Samples.hpp"
+#include "DataChannels.hpp"
+#include "EventBus.hpp"
+
+namespace WUI
+{
+    // Live comparison of the two ways to get a float array into the page (webUI --data-bench):
+    // a DataChannels snapshot against a Float32Array literal run with ExecuteJavaScript.
+    // html/index.html#databench reads every new array in requestAnimationFrame and acks its generation over the bus,
+    // latency is publish to ack, so both paths include one frame of the page and the bus trip back.
+    class DataChannelBench
+    {
+    public:
+        enum Path
+        {
+            SHARED,
+            SCRIPT,
+            PATHS,
+        };
+
+    private:
+        struct Result
+        {
+            Samples send;    // engine side: encode and hand over, seconds
+            Samples latency; // publish to ack, seconds
+            size_t sent = 0;
+            double elapsed = 0;
+        };
+
+        CefRefPtr<DataChannels> m_channels;
+        CefRefPtr<EventBus> m_bus;
+        CefRefPtr<CefFrame> m_frame;
+        size_t m_floats;
+
+        std::mutex l_pending;
+        std::map<uint64_t, double> m_pending[PATHS]; // generation -> publish time
+        Result m_results[PATHS];
+        BusSubscription m_subscriptions[PATHS + 1] = {};
+        bool m_ready = false;
+
+    public:
+        DataChannelBench(CefRefPtr<DataChannels> channels, CefRefPtr<EventBus> bus, CefRefPtr<CefBrowser> browser, size_t floats);
+        ~DataChannelBench();
+
+        // Blocks, waits up to `ready_timeout` seconds for the page and runs each path for `seconds` at `fps`.
+        // Returns early once `stop` is set. False if it did not run to the end or fps is not positive.
+        bool run(double seconds, int fps, double ready_timeout, const std::atomic<bool> &stop);
+
+        void report(FILE *out);
+
+        // the script the ExecuteJavaScript path runs for one array, shortest round trip float formatting
+        static std::string encodeScript(uint64_t generation, const float *data, size_t count);
+
+    private:
+        void acked(Path path, uint64_t generation);
+    };
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "RenderHandler.hpp"
+
+namespace WUI
+{
+    // What the sections of webUI --bench share: the parsed options, the timing loops and the headless fixture.
+    // Every subsystem has its own file in src/Bench/, Bench.cpp only parses the command line and runs them in order.
+    namespace Bench
+    {
+        struct Options
+        {
+            int width = 1920;
+            int height = 1080;
+            int frames = 600;
+            std::string pattern = "caret";
+            double paints_per_frame = 1;
+            int balls = 0;
+            std::string only; // comma separated section names, empty = all of them
+            std::string trace_path; // empty = no trace
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        inline double secondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        // how often a timed loop ran its body and for how long
+        struct Timed
+        {
+            size_t runs = 0;
+            double seconds = 0;
+
+            double perRun() const
+            {
+                return runs ? seconds / runs : 0;
+            }
+
+            // `units` done per run, per second
+            double rate(double units) const
+            {
+                return seconds > 0 ? runs * units / seconds : 0;
+            }
+        };
+
+        // runs fn at least once and until `seconds` passed
+        template <typename Fn>
+        Timed timeFor(double seconds, Fn &&fn)
+        {
+            Timed timed;
+            const auto start = Clock::now();
+            do
+            {
+                fn();
+                timed.runs++;
+            } while ((timed.seconds = secondsSince(start)) < seconds);
+            return timed;
+        }
+
+        // runs fn exactly `runs` times
+        template <typename Fn>
+        Timed timeRuns(size_t runs, Fn &&fn)
+        {
+            Timed timed;
+            const auto start = Clock::now();
+            for (; timed.runs < runs; timed.runs++)
+            {
+                fn();
+            }
+            timed.seconds = secondsSince(start);
+            return timed;
+        }
+
+        // a RenderHandler drawing into a memory bitmap of the given size, the remaining settings at their defaults
+        CefRefPtr<RenderHandler> headlessHandler(int width, int height, RenderSettings settings = RenderSettings());
+
+        // Sections, one per subsystem. Each prints its own block and returns false if a verification failed,
+        // sections that only measure return true.
+
+        // BenchPixels.cpp
+        bool pixelKernels(const Options &options);
+
+        // BenchBalls.cpp
+        bool ballPhysics(const Options &options);
+        bool broadphase(const Options &options);
+        bool parallelUpdate(const Options &options);
+        bool spawn(const Options &options);
+
+        // BenchInput.cpp
+        bool inputCoalescing(const Options &options);
+
+        // BenchBus.cpp
+        bool eventBus(const Options &options);
+        bool sharedData(const Options &options);
+
+        // BenchResources.cpp
+        bool resources(const Options &options);
+
+        // BenchStartup.cpp
+        bool startupReport(const Options &options);
+
+        // BenchRender.cpp
+        bool resize(const Options &options);
+        bool popup(const Options &options);
+        bool uploadModes(const Options &options);
+        bool pipeline(const Options &options);
+    }
+}
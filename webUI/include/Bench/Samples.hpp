@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace WUI
+{
+    // Collected measurements of one benchmark stage
+    class Samples
+    {
+    private:
+        std::vector<double> m_values;
+        mutable std::vector<double> m_sorted;
+        mutable bool m_dirty = false;
+
+    public:
+        void reserve(size_t count)
+        {
+            m_values.reserve(count);
+        }
+
+        void add(double value)
+        {
+            m_values.push_back(value);
+            m_dirty = true;
+        }
+
+        // in the order they were added
+        const std::vector<double> &values() const
+        {
+            return m_values;
+        }
+
+        size_t count() const
+        {
+            return m_values.size();
+        }
+
+        double sum() const
+        {
+            double total = 0;
+            for (double value : m_values)
+            {
+                total += value;
+            }
+            return total;
+        }
+
+        // nearest rank percentile, p in [0, 1]
+        double percentile(double p) const
+        {
+            if (m_values.empty())
+            {
+                return 0;
+            }
+            if (m_dirty)
+            {
+                m_sorted = m_values;
+                std::sort(m_sorted.begin(), m_sorted.end());
+                m_dirty = false;
+            }
+            size_t rank = (size_t)std::ceil(p * m_sorted.size());
+            return m_sorted[std::min(m_sorted.size(), std::max<size_t>(rank, 1)) - 1];
+        }
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <allegro5/allegro.h>
+
+#include <include/cef_app.h>
+
+#include "RenderProcessHandler.hpp"
+
+// posted into the render loop whenever CEF wants its message loop pumped, user.data1 = delay in ms
+#define WUI_EVENT_PUMP_WORK ALLEGRO_GET_EVENT_TYPE('W', 'U', 'I', 'P')
+
+namespace WUI
+{
+
+    // Application level CEF callbacks, passed to CefExecuteProcess and CefInitialize
+    class BrowserApp : public CefApp, public CefBrowserProcessHandler
+    {
+    private:
+        // CEF runs with external_message_pump, scheduling requests are forwarded through here
+        ALLEGRO_EVENT_SOURCE m_pump_event_source;
+
+        // only used when this executable runs as the render process
+        CefRefPtr<RenderProcessHandler> m_render_process_handler;
+
+    public:
+        BrowserApp();
+        ~BrowserApp();
+
+        ALLEGRO_EVENT_SOURCE *getPumpEventSource()
+        {
+            return &m_pump_event_source;
+        }
+
+        // CefApp interface
+        virtual CefRefPtr<CefBrowserProcessHandler> GetBrowserProcessHandler() override
+        {
+            return this;
+        }
+
+        virtual CefRefPtr<CefRenderProcessHandler> GetRenderProcessHandler() override
+        {
+            return m_render_process_handler;
+        }
+
+        // every process, app:// has to be known before any page loads
+        virtual void OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar) override;
+
+        // CefBrowserProcessHandler interface, may be called from any thread
+        virtual void OnScheduleMessagePumpWork(int64_t delay_ms) override;
+
+        IMPLEMENT_REFCOUNTING(BrowserApp);
+    };
+}
@@ -1,21 +1,30 @@
 #pragma once
 
+#include <functional>
+
 #include "include/cef_client.h"
 
+#include "DataChannels.hpp"
+#include "EventBus.hpp"
 #include "RenderHandler.hpp"
+#include "util/startup_report.hpp"
 
 namespace WUI
 {
 
     // Client actually handling the html internals
-    class BrowserClient : public CefClient
+    class BrowserClient : public CefClient, public CefLifeSpanHandler, public CefLoadHandler
     {
     public:
         CefRefPtr<CefRenderHandler> m_renderHandler;
+        CefRefPtr<EventBus> m_bus;
+        CefRefPtr<DataChannels> m_data;
+
+        std::function<void(CefRefPtr<CefBrowser>)> m_on_created;
 
     public:
         BrowserClient(CefRefPtr<WUI::RenderHandler> &renderHandler)
-            : m_renderHandler(renderHandler)
+            : m_renderHandler(renderHandler), m_bus(new EventBus()), m_data(new DataChannels())
         {
         }
 
@@ -24,6 +33,58 @@ namespace WUI
             return m_renderHandler;
         }
 
+        virtual CefRefPtr<CefLifeSpanHandler> GetLifeSpanHandler() override
+        {
+            return this;
+        }
+
+        virtual CefRefPtr<CefLoadHandler> GetLoadHandler() override
+        {
+            return this;
+        }
+
+        // CreateBrowser is asynchronous, whatever needs the browser goes in here. Set before CreateBrowser.
+        void onBrowserCreated(std::function<void(CefRefPtr<CefBrowser>)> callback)
+        {
+            m_on_created = std::move(callback);
+        }
+
+        // CefLifeSpanHandler interface, UI thread
+        virtual void OnAfterCreated(CefRefPtr<CefBrowser> browser) override
+        {
+            Startup::mark(Startup::BrowserCreated);
+            if (m_on_created)
+            {
+                m_on_created(browser);
+            }
+        }
+
+        // CefLoadHandler interface, UI thread
+        virtual void OnLoadEnd(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, int httpStatusCode) override
+        {
+            if (frame->IsMain())
+            {
+                Startup::mark(Startup::LoadEnd);
+            }
+        }
+
+        // events to and from the page, see window.wui in RenderProcessHandler
+        CefRefPtr<EventBus> getBus()
+        {
+            return m_bus;
+        }
+
+        // bulk typed arrays for the page, see wui.data
+        CefRefPtr<DataChannels> getData()
+        {
+            return m_data;
+        }
+
+        virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message) override
+        {
+            return m_bus->onProcessMessage(message);
+        }
+
         IMPLEMENT_REFCOUNTING(BrowserClient);
     };
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace WUI
+{
+    // Wire format of the JS <-> engine event bus, shared by the browser and the render process.
+    // A batch is one binary blob in one CefProcessMessage, however many events it carries:
+    //
+    //   u32 magic, u32 count, count x { u8 flags, u16 topic length, topic, u8 type, payload }
+    //
+    // payload: Null none, Bool u8, Number f64, String u32 length + bytes. Both ends are the same binary on the
+    // same machine, numbers are copied in host byte order.
+    namespace Bus
+    {
+        static const char *const MESSAGE_NAME = "wui.bus";
+
+        static constexpr uint32_t MAGIC = 0x42495557; // "WUIB"
+
+        enum : uint8_t
+        {
+            FLAG_STATE = 1, // latest value of the topic, receivers keep it for late subscribers
+        };
+
+        // what JS can hand over without a serializer: null, booleans, numbers and strings
+        struct Value
+        {
+            enum class Type : uint8_t
+            {
+                Null,
+                Bool,
+                Number,
+                String,
+            };
+
+            Type type = Type::Null;
+            double number = 0; // Bool and Number
+            std::string string;
+
+            static Value boolean(bool value)
+            {
+                Value result;
+                result.type = Type::Bool;
+                result.number = value;
+                return result;
+            }
+
+            static Value of(double value)
+            {
+                Value result;
+                result.type = Type::Number;
+                result.number = value;
+                return result;
+            }
+
+            static Value of(std::string value)
+            {
+                Value result;
+                result.type = Type::String;
+                result.string = std::move(value);
+                return result;
+            }
+        };
+
+        // Appends events to one growing blob, reused between batches without reallocating
+        class BatchWriter
+        {
+        private:
+            std::vector<uint8_t> m_bytes;
+            uint32_t m_count = 0;
+
+        public:
+            BatchWriter();
+
+            void add(const std::string &topic, const Value &value, uint8_t flags = 0);
+
+            uint32_t count() const
+            {
+                return m_count;
+            }
+
+            bool empty() const
+            {
+                return m_count == 0;
+            }
+
+            // the complete batch, valid until the next add or clear
+            const std::vector<uint8_t> &bytes() const
+            {
+                return m_bytes;
+            }
+
+            void clear();
+        };
+
+        // internal, read the batch header / one event at `offset`
+        bool decodeEvent(const uint8_t *data, size_t size, size_t &offset, std::string &topic, Value &value, uint8_t &flags);
+        bool decodeHeader(const uint8_t *data, size_t size, uint32_t &count);
+
+        // Calls fn(topic, value, flags) for every event in a batch, false if it is malformed.
+        // Events before the damage were delivered already.
+        template <typename Fn>
+        bool decode(const uint8_t *data, size_t size, Fn &&fn)
+        {
+            uint32_t count;
+            if (!decodeHeader(data, size, count))
+            {
+                return false;
+            }
+
+            size_t offset = 8;
+            std::string topic;
+            Value value;
+            uint8_t flags;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (!decodeEvent(data, size, offset, topic, value, flags))
+                {
+                    return false;
+                }
+                fn(topic, value, flags);
+            }
+            return true;
+        }
+    }
+}
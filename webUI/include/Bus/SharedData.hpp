@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace WUI
+{
+    // Layout of one typed array snapshot in shared memory, written by DataChannels and read by RenderProcessHandler,
+    // which copies the array into the page. Every publish is its own region, a reader never sees it change:
+    //
+    //   DataHeader, channel name, padding, array data at data_offset (DATA_ALIGNMENT aligned)
+    namespace Bus
+    {
+        static const char *const DATA_MESSAGE_NAME = "wui.data";
+
+        static constexpr uint32_t DATA_MAGIC = 0x44495557; // "WUID"
+
+        // any typed array view is allowed on the data
+        static constexpr size_t DATA_ALIGNMENT = 16;
+
+        enum class DataType : uint32_t
+        {
+            U8,
+            I32,
+            U32,
+            F32,
+            F64,
+        };
+
+        template <typename T>
+        struct DataTypeOf;
+        template <>
+        struct DataTypeOf<uint8_t>
+        {
+            static constexpr DataType value = DataType::U8;
+        };
+        template <>
+        struct DataTypeOf<int32_t>
+        {
+            static constexpr DataType value = DataType::I32;
+        };
+        template <>
+        struct DataTypeOf<uint32_t>
+        {
+            static constexpr DataType value = DataType::U32;
+        };
+        template <>
+        struct DataTypeOf<float>
+        {
+            static constexpr DataType value = DataType::F32;
+        };
+        template <>
+        struct DataTypeOf<double>
+        {
+            static constexpr DataType value = DataType::F64;
+        };
+
+        inline size_t dataTypeSize(DataType type)
+        {
+            switch (type)
+            {
+            case DataType::U8:
+                return 1;
+            case DataType::F64:
+                return 8;
+            default:
+                return 4;
+            }
+        }
+
+        // the typed array constructor the page should use
+        inline const char *dataTypeName(DataType type)
+        {
+            switch (type)
+            {
+            case DataType::U8:
+                return "Uint8Array";
+            case DataType::I32:
+                return "Int32Array";
+            case DataType::U32:
+                return "Uint32Array";
+            case DataType::F32:
+                return "Float32Array";
+            default:
+                return "Float64Array";
+            }
+        }
+
+        struct DataHeader
+        {
+            uint32_t magic;
+            DataType type;
+            uint64_t generation; // per channel, starts at 1
+            uint64_t count;      // elements, not bytes
+            uint32_t name_length;
+            uint32_t data_offset;
+        };
+
+        inline size_t dataOffset(size_t name_length)
+        {
+            return (sizeof(DataHeader) + name_length + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+        }
+
+        inline size_t dataRegionSize(size_t name_length, DataType type, size_t count)
+        {
+            return dataOffset(name_length) + count * dataTypeSize(type);
+        }
+
+        // fills in everything but the array data, `memory` has dataRegionSize() bytes
+        inline void writeDataHeader(void *memory, const std::string &name, DataType type, uint64_t generation, size_t count)
+        {
+            DataHeader header;
+            header.magic = DATA_MAGIC;
+            header.type = type;
+            header.generation = generation;
+            header.count = count;
+            header.name_length = (uint32_t)name.size();
+            header.data_offset = (uint32_t)dataOffset(name.size());
+
+            memcpy(memory, &header, sizeof(header));
+            memcpy((uint8_t *)memory + sizeof(header), name.data(), name.size());
+        }
+
+        // false if `memory` does not hold a complete snapshot
+        inline bool readDataHeader(const void *memory, size_t size, DataHeader &header, std::string &name)
+        {
+            if (!memory || size < sizeof(DataHeader))
+            {
+                return false;
+            }
+            memcpy(&header, memory, sizeof(header));
+
+            if (header.magic != DATA_MAGIC || header.type > DataType::F64 ||
+                header.data_offset != dataOffset(header.name_length) || header.data_offset > size ||
+                header.count > (size - header.data_offset) / dataTypeSize(header.type))
+            {
+                return false;
+            }
+
+            name.assign((const char *)memory + sizeof(header), header.name_length);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <include/cef_browser.h>
+
+#include "Bus/SharedData.hpp"
+
+namespace WUI
+{
+    // Bulk per-frame data for the page (minimaps, entity lists, graphs) without serialising it.
+    // Every publish writes one typed array into a fresh shared memory region that travels with a CefProcessMessage,
+    // the renderer copies it into an ArrayBuffer once per generation, the first time the page asks for it:
+    //
+    //   const snapshot = wui.data('minimap'); // {generation, type: 'Float32Array', count, buffer} or null
+    //   if (snapshot && snapshot.generation !== seen) { seen = snapshot.generation; draw(new Float32Array(snapshot.buffer)); }
+    //
+    // A snapshot never changes once published, a newer one replaces it. The buffer belongs to the page, writing into
+    // it does not touch the shared memory.
+    class DataChannels : public virtual CefBaseRefCounted
+    {
+    private:
+        std::mutex l_channels;
+        CefRefPtr<CefFrame> m_frame;                       // main frame of the page, null before setBrowser
+        std::unordered_map<std::string, uint64_t> m_generations;
+
+        std::atomic<uint64_t> m_published{0};
+        std::atomic<uint64_t> m_bytes{0};
+
+    public:
+        // Any thread. Returns the generation of the new snapshot, 0 if there is no page yet or no shared memory.
+        template <typename T>
+        uint64_t publish(const std::string &name, const T *data, size_t count)
+        {
+            return publish(name, Bus::DataTypeOf<T>::value, count, [=](void *out)
+                           { memcpy(out, data, count * sizeof(T)); });
+        }
+
+        // same, `fill` writes the `count` elements straight into the shared memory, no staging copy
+        uint64_t publish(const std::string &name, Bus::DataType type, size_t count, const std::function<void(void *)> &fill);
+
+        // any thread
+        void setBrowser(CefRefPtr<CefBrowser> browser);
+
+        uint64_t getPublished() const
+        {
+            return m_published;
+        }
+
+        // array data only
+        uint64_t getBytesPublished() const
+        {
+            return m_bytes;
+        }
+
+        IMPLEMENT_REFCOUNTING(DataChannels);
+    };
+}
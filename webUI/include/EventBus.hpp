@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <include/cef_browser.h>
+#include <include/cef_process_message.h>
+
+#include "Bus/BusCodec.hpp"
+
+namespace WUI
+{
+    typedef uint64_t BusSubscription; // 0 is never handed out
+    typedef std::function<void(const Bus::Value &)> BusHandler;
+
+    // Engine side of the JS <-> engine event bus (the page side is window.wui, see RenderProcessHandler).
+    // Events published from any thread are encoded into one binary batch and sent to the render process once per
+    // UI frame as a single CefProcessMessage, so thousands of small updates cost a handful of IPCs per second.
+    class EventBus : public virtual CefBaseRefCounted
+    {
+    private:
+        std::mutex l_outgoing;
+        Bus::BatchWriter m_events;                          // every published event, in order
+        std::unordered_map<std::string, Bus::Value> m_state; // latest set() per topic, only the last one is sent
+        std::atomic<bool> m_flush_scheduled{false};
+        std::atomic<int> m_flush_delay_ms{16};
+
+        CefRefPtr<CefBrowser> m_browser; // UI thread
+
+        std::mutex l_subscribers;
+        std::unordered_map<std::string, std::vector<std::pair<BusSubscription, BusHandler>>> m_subscribers;
+        std::unordered_map<BusSubscription, std::string> m_topics;
+        BusSubscription m_next_subscription = 1;
+
+        std::atomic<uint64_t> m_events_sent{0};
+        std::atomic<uint64_t> m_messages_sent{0};
+
+    public:
+        // page events for `topic`, handlers run on the CEF UI thread and should stay short
+        BusSubscription subscribe(const std::string &topic, BusHandler handler);
+        void unsubscribe(BusSubscription id);
+
+        // Any thread. publish sends every event, set only the newest value per topic and frame and the page
+        // keeps it for subscribers that come later (scores, counters, ...).
+        void publish(const std::string &topic, Bus::Value value = Bus::Value());
+        void set(const std::string &topic, Bus::Value value);
+
+        // UI thread, nothing is sent before there is a browser
+        void setBrowser(CefRefPtr<CefBrowser> browser);
+
+        // batches go out at this rate, any thread
+        void setFrameRate(int fps);
+
+        // UI thread: send what is pending now
+        void flush();
+
+        // UI thread, from CefClient::OnProcessMessageReceived. False if the message is not for the bus.
+        bool onProcessMessage(CefRefPtr<CefProcessMessage> message);
+
+        uint64_t getEventsSent() const
+        {
+            return m_events_sent;
+        }
+
+        uint64_t getMessagesSent() const
+        {
+            return m_messages_sent;
+        }
+
+    private:
+        void scheduleFlush();
+
+        IMPLEMENT_REFCOUNTING(EventBus);
+    };
+}
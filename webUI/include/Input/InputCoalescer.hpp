@@ -0,0 +1,85 @@
+#pragma once
+#include <limits>
+
+#include "Math/vec.hpp"
+
+namespace WUI
+{
+    // Folds a fast stream of mouse moves and wheel ticks into at most one forward per interval (a UI frame).
+    // Moves keep only the latest position, wheel deltas add up. The first input after a quiet period goes out
+    // right away, so coalescing only ever delays input that arrives faster than the UI can show it.
+    // Input thread only.
+    class InputCoalescer
+    {
+    public:
+        static constexpr double NEVER = std::numeric_limits<double>::infinity();
+
+        // what is due to be sent
+        struct Pending
+        {
+            bool move = false;
+            vec2i position = {0, 0};
+            int wheel_z = 0; // allegro dz, vertical ticks, positive away from the user
+            int wheel_w = 0; // allegro dw, horizontal ticks
+        };
+
+    private:
+        double m_interval;
+        double m_last_flush = -NEVER;
+        bool m_has_pending = false;
+        Pending m_pending;
+
+    public:
+        explicit InputCoalescer(double interval_s = 1.0 / 60)
+            : m_interval(interval_s)
+        {
+        }
+
+        void setInterval(double interval_s)
+        {
+            m_interval = interval_s;
+        }
+
+        void move(int x, int y)
+        {
+            m_pending.move = true;
+            m_pending.position = {x, y};
+            m_has_pending = true;
+        }
+
+        void wheel(int dz, int dw)
+        {
+            m_pending.wheel_z += dz;
+            m_pending.wheel_w += dw;
+            m_has_pending = m_has_pending || dz || dw;
+        }
+
+        bool hasPending() const
+        {
+            return m_has_pending;
+        }
+
+        // time the pending input has to go out at, NEVER if there is none
+        double deadline() const
+        {
+            return m_has_pending ? m_last_flush + m_interval : NEVER;
+        }
+
+        bool due(double now) const
+        {
+            return m_has_pending && now >= deadline();
+        }
+
+        // hand out everything pending and start a new interval.
+        // Button and key events take this first regardless of the deadline, so they never overtake a move.
+        Pending take(double now)
+        {
+            Pending pending = m_pending;
+            m_pending = Pending();
+            m_pending.position = pending.position;
+            m_has_pending = false;
+            m_last_flush = now;
+            return pending;
+        }
+    };
+}
@@ -1,48 +1,152 @@
 #pragma once
 #include <allegro5/allegro.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Input/InputCoalescer.hpp"
+#include "Input/LatencyProbe.hpp"
 #include "Math/vec.hpp"
 #include "include/cef_browser.h"
+#include "util/dispatch_pool.hpp"
 
 namespace WUI
 {
+    typedef uint64_t InputSubscription; // 0 is never handed out
+    typedef std::function<void(const ALLEGRO_EVENT &)> InputHandler;
+
+    // an event, or nothing once the InputManager shut down
+    typedef std::future<std::optional<ALLEGRO_EVENT>> InputAwaitable;
+
+    // how much of the raw mouse stream made it into CEF
+    struct InputStats
+    {
+        uint64_t moves_received = 0;
+        uint64_t moves_forwarded = 0;
+        uint64_t wheel_received = 0;
+        uint64_t wheel_forwarded = 0;
+    };
 
     class InputManager
     {
     private:
+        // allegro numbers mouse buttons from 1, masks use bit (button - 1)
+        static constexpr int MOUSE_BUTTONS = 32;
+        static constexpr unsigned DISPATCH_THREADS = 2;
+        static constexpr int WHEEL_TICK_PX = 40;
+
+        struct Subscriber
+        {
+            InputSubscription id;
+            std::shared_ptr<InputHandler> handler;                               // runs on the dispatch pool
+            std::shared_ptr<std::promise<std::optional<ALLEGRO_EVENT>>> promise; // one shot instead, fulfilled in place
+        };
+
+        enum class Route
+        {
+            Type,
+            Key,
+            MouseButton,
+        };
+
+        // where a subscription is filed, for unsubscribe
+        struct Filing
+        {
+            Route route;
+            int value; // event type, keycode or button mask
+        };
+
         static InputManager *m_instance;
         static CefRefPtr<CefBrowserHost> m_browser_host;
 
         ALLEGRO_EVENT_QUEUE *m_InputManager_event_queue; // main queue for the GameManager
 
-        ALLEGRO_EVENT_SOURCE m_InputManager_event_source; // where the manager tells "wait for keys" if something was pressed or not
+        ALLEGRO_EVENT_SOURCE m_InputManager_event_source; // wakes the input loop on shutdown
         vec2i m_mouse_state;
         std::mutex l_mouse_state;
 
         std::thread m_input_thread;
 
+        // Subscribers filed by what they listen for, an event only looks at its own buckets
+        std::mutex l_subscribers;
+        std::unordered_map<int, std::vector<Subscriber>> m_by_type; // ALLEGRO_EVENT_TYPE
+        std::unordered_map<int, std::vector<Subscriber>> m_by_key;  // key down, by keycode
+        std::array<std::vector<Subscriber>, MOUSE_BUTTONS> m_by_button; // button down
+        std::unordered_map<InputSubscription, Filing> m_filings;
+        InputSubscription m_next_subscription = 1;
+
+        std::vector<Subscriber> m_matched; // input thread only
+        DispatchPool m_dispatch;
+
+        InputCoalescer m_coalescer; // input thread only
+        std::atomic<LatencyProbe *> m_latency_probe{nullptr};
+        std::atomic<double> m_move_interval{1.0 / 60};
+        struct
+        {
+            std::atomic<uint64_t> moves_received{0};
+            std::atomic<uint64_t> moves_forwarded{0};
+            std::atomic<uint64_t> wheel_received{0};
+            std::atomic<uint64_t> wheel_forwarded{0};
+        } m_stats;
+
         InputManager();
 
         void update_mouse_pos();
         void input_loop();
+        void dispatch(const ALLEGRO_EVENT &event);
+        // send the coalesced move and wheel to CEF now
+        void flush_coalesced();
+
+        InputSubscription file(Route route, int value, Subscriber subscriber);
+        // l_subscribers held
+        void unfile(InputSubscription id);
+        void collect(std::vector<Subscriber> &bucket);
 
         // control
-        bool m_running = true;
+        std::atomic<bool> m_running{true};
 
     public:
         static InputManager *instance(CefRefPtr<CefBrowserHost> browser_host = nullptr);
 
         vec2i get_mouse_position();
 
+        // mouse moves reach CEF at most this often, any thread
+        void set_ui_frame_rate(int fps);
+
+        InputStats get_stats() const;
+
+        // stamp every click forwarded to CEF
+        void set_latency_probe(LatencyProbe *probe);
+
+        // feed a synthetic mouse or key event through the same path as real input, any thread
+        void inject(ALLEGRO_EVENT event);
+
         std::thread *get_thread()
         {
             return &m_input_thread;
         }
 
-        bool wait_for_key(int keycode); // block until key is pressed
-        bool wait_for_mouse_button(int button, vec2i &mouse_pos);
+        // Handlers run on a shared dispatch pool, in order per subscription. Nothing is copied or woken for
+        // events nobody subscribed to.
+        InputSubscription subscribe(ALLEGRO_EVENT_TYPE type, InputHandler handler);
+        InputSubscription subscribe_key(int keycode, InputHandler handler);             // key down
+        InputSubscription subscribe_mouse_button(int button_mask, InputHandler handler); // button down
+        void unsubscribe(InputSubscription id);
+
+        // next matching event, once
+        InputAwaitable next_key(int keycode);
+        InputAwaitable next_mouse_button(int button_mask);
+
+        // block until key is pressed, false on shutdown
+        bool wait_for_key(int keycode);
+        bool wait_for_mouse_button(int button_mask, vec2i &mouse_pos);
 
         void shutdown();
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+
+#include "Bench/Samples.hpp"
+
+namespace WUI
+{
+    // Input to photon latency of mouse clicks.
+    // html/index.html opened with #latency keeps a 2x2 px marker in the top left corner whose colour encodes how
+    // many mousedowns the page has handled. The input loop stamps every click it forwards, OnPaint reads the
+    // marker back out of the paint buffer and the render loop reports the marker of the frame it just flipped.
+    // Click n is on screen once a flipped frame carries marker n.
+    class LatencyProbe
+    {
+    public:
+        static constexpr uint32_t NO_MARKER = UINT32_MAX;
+
+        // marker pixel: red = count low byte, green = count high byte, blue = signature
+        static constexpr uint8_t SIGNATURE = 0xA5;
+
+        // histogram buckets
+        static constexpr double BUCKET_MS = 4;
+        static constexpr int BUCKETS = 25;
+
+    private:
+        std::mutex m_lock;
+        bool m_ready = false;       // the page showed its marker, clicks from here on are counted on both sides
+        uint64_t m_sent = 0;        // clicks forwarded
+        uint64_t m_presented = 0;   // clicks on screen
+        std::deque<double> m_input_times; // clicks m_presented + 1 .. m_sent
+        Samples m_latencies_ms;
+
+    public:
+        // counter in the top left pixel of a BGRA paint buffer, NO_MARKER if the page shows none
+        static uint32_t decode(const void *bgra, int width, int height);
+
+        // input thread: a click went to CEF, `time` is the allegro event timestamp (al_get_time clock)
+        void inputSent(double time);
+
+        // render thread: a frame showing `marker` was flipped at `time`
+        void presented(uint32_t marker, double time);
+
+        bool ready();
+        size_t count();
+
+        // percentiles and a histogram
+        void report(FILE *out);
+    };
+}
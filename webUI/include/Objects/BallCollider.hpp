@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Objects/UniformGrid.hpp"
+#include "util/aligned_vector.hpp"
+#include "util/task_scheduler.hpp"
+
+namespace WUI
+{
+    // Ball-ball collisions over a UniformGrid broadphase, mass proportional to the area.
+    // Every ball is resolved on its own against a snapshot of its neighbours (gather, never scatter), so the
+    // result does not depend on the order the balls are visited in and the pass can be split across threads.
+    class BallCollider
+    {
+    public:
+        // Neighbours tested per ball and tick. A pile of balls spawned on one spot would otherwise cost n^2
+        // in its first ticks, capped it pushes apart over a few ticks instead.
+        static constexpr size_t MAX_CANDIDATES = 64;
+
+    private:
+        UniformGrid m_grid;
+        uint64_t m_layout_version = UINT64_MAX; // of the balls the grid was last built over
+        float m_max_radius = 0;
+
+        // components gathered into grid order, neighbours are adjacent in memory
+        AlignedVector<float> m_x;
+        AlignedVector<float> m_y;
+        AlignedVector<float> m_vx;
+        AlignedVector<float> m_vy;
+        AlignedVector<float> m_radius;
+
+        AlignedVector<float> m_out_x;
+        AlignedVector<float> m_out_y;
+        AlignedVector<float> m_out_vx;
+        AlignedVector<float> m_out_vy;
+
+    public:
+        // Rebuild the grid over `count` balls and push overlapping ones apart, exchanging momentum along the
+        // contact normal. Results are written back clamped into [0, width] x [0, height].
+        // `layout_version` changes whenever the set of balls does (BallStore::layoutVersion).
+        // The passes are split across `scheduler`, the result is the same for any thread count.
+        void resolve(float *x, float *y, float *vx, float *vy, const float *radius, size_t count,
+                     float width, float height, uint64_t layout_version, TaskScheduler &scheduler);
+
+        // dense index of the topmost (last drawn) ball containing the point, -1 if there is none.
+        // Reuses the grid of the last resolve while the layout is unchanged.
+        int64_t pick(float px, float py, const float *x, const float *y, const float *radius, size_t count,
+                     float width, float height, uint64_t layout_version);
+
+        const UniformGrid &getGrid() const
+        {
+            return m_grid;
+        }
+
+    private:
+        void rebuild(const float *x, const float *y, const float *radius, size_t count,
+                     float width, float height, uint64_t layout_version);
+
+        // resolves grid positions [begin, end) from the gathered components into the out arrays
+        void resolveRange(size_t begin, size_t end, float width, float height);
+    };
+}
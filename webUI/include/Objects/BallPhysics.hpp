@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+#include "util/cpu_isa.hpp"
+
+namespace WUI
+{
+    // Integration of the ball components in BallStore. Velocities are stored per axis, so a wall bounce
+    // only flips the sign of one component and no trig runs per frame.
+    namespace BallPhysics
+    {
+        // Move `count` balls by velocity * delta_t, clamp them into [0, width] x [0, height] and reflect the
+        // velocity component of every axis they hit. Arrays may be unaligned.
+        typedef void (*StepKernel)(float *x, float *y, float *vx, float *vy, size_t count,
+                                   float width, float height, float delta_t);
+
+        // runs the best kernel for this cpu
+        void step(float *x, float *y, float *vx, float *vy, size_t count,
+                  float width, float height, float delta_t);
+
+        Isa activeIsa();
+
+        // kernel for a specific isa, nullptr if it was not compiled in.
+        // All of them produce bit identical results.
+        StepKernel stepKernel(Isa isa);
+    }
+}
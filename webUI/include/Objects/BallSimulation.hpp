@@ -0,0 +1,123 @@
+#pragma once
+#include <allegro5/allegro.h>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Objects/BallStore.hpp"
+#include "Objects/CircleBatch.hpp"
+#include "Render/FrameScheduler.hpp"
+#include "util/mpsc_queue.hpp"
+#include "util/triple_buffer.hpp"
+
+namespace WUI
+{
+    // State of all balls after one simulation tick, with the positions before it for interpolation
+    struct BallSnapshot
+    {
+        uint64_t tick = 0;
+        double time = 0; // steady clock seconds at which this state is current
+
+        uint64_t layout_version = UINT64_MAX;
+        std::vector<float> prev_x;
+        std::vector<float> prev_y;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> radius;
+        std::vector<ALLEGRO_COLOR> color;
+
+        size_t size() const
+        {
+            return x.size();
+        }
+
+        // positions `alpha` of the way from the previous tick to this one into out_x/out_y, alpha in [0, 1].
+        // Only balls [begin, end), so the render loop can split the work.
+        void interpolate(float alpha, size_t begin, size_t end, float *out_x, float *out_y) const;
+
+        // the circles to draw with positions from interpolate
+        Circles circles(const float *positions_x, const float *positions_y) const;
+    };
+
+    // a change to the set of balls, queued by any thread and applied at the start of the next tick
+    struct BallCommand
+    {
+        enum class Type
+        {
+            Spawn,  // one ball with random properties per position
+            Remove,
+            Clear,
+            Pick, // answers with the ball under positions[0]
+        };
+
+        Type type = Type::Spawn;
+        std::vector<vec2f> positions; // Spawn, Pick
+        BallHandle handle;            // Remove
+        std::shared_ptr<std::promise<BallHandle>> picked; // Pick
+    };
+
+    // Runs the balls at a fixed tick on its own thread, independent of the display refresh and of stalls in
+    // the render loop. Every tick is published through a lock free triple buffer, the render loop draws the
+    // newest one interpolated to the current time.
+    class BallSimulation
+    {
+    public:
+        static constexpr double TICK_RATE = 120;
+        static constexpr double TICK_SECONDS = 1.0 / TICK_RATE;
+
+    private:
+        // after a stall longer than this the missed time is dropped instead of simulated in a burst
+        static constexpr int MAX_CATCHUP_TICKS = 8;
+
+        BallStore m_balls; // simulation thread only
+        MpscQueue<BallCommand> m_commands;
+
+        TripleBuffer<BallSnapshot> m_snapshots;
+        uint64_t m_tick = 0;
+        uint64_t m_published_layout = UINT64_MAX;
+
+        std::atomic<float> m_width;
+        std::atomic<float> m_height;
+
+        FrameScheduler &m_frame_scheduler; // woken when balls appear or disappear
+        std::atomic<bool> m_running{false};
+        std::thread m_thread;
+
+    public:
+        BallSimulation(FrameScheduler &frame_scheduler, float width, float height);
+        ~BallSimulation();
+
+        void start();
+        // joins the simulation thread and applies what is still queued, safe to call more than once
+        void stop();
+
+        // area the balls bounce in, any thread
+        void setBounds(float width, float height);
+
+        // Any thread, never blocks. Takes effect with the next tick.
+        void spawn(float x, float y);
+        // one command for all of them, for tools and tests that add balls by the thousand
+        void spawn(std::vector<vec2f> positions);
+        // stale handles are ignored
+        void remove(BallHandle handle);
+        void clear();
+
+        // Ball under the point as of the next tick, an invalid handle if there is none.
+        // Answered by stop() if the simulation stops first. Once stopped a pick waits for the next
+        // start() or stop(), wait with a timeout.
+        std::future<BallHandle> pick(float x, float y);
+
+        // render thread: newest published tick, nullptr before the first one
+        const BallSnapshot *latest();
+
+    private:
+        void run();
+        void applyCommands();
+        void tick(double time);
+        void publish(double time);
+    };
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Math/vec.hpp"
+#include "Objects/BallCollider.hpp"
+#include "util/aligned_vector.hpp"
+#include "util/task_scheduler.hpp"
+
+namespace WUI
+{
+    // Stable reference to one ball. Removing other balls never invalidates it, a removed ball's handle
+    // is detected as stale instead of silently pointing at whatever took its place.
+    struct BallHandle
+    {
+        uint32_t slot = UINT32_MAX;
+        uint32_t generation = 0;
+
+        // false for a default constructed handle, e.g. a pick that found nothing
+        bool valid() const
+        {
+            return slot != UINT32_MAX;
+        }
+
+        bool operator==(const BallHandle &other) const
+        {
+            return slot == other.slot && generation == other.generation;
+        }
+
+        bool operator!=(const BallHandle &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    // All balls, struct of arrays. Every component lives in its own dense array indexed by the same position,
+    // so the update pass streams linearly through memory instead of chasing one heap object per ball.
+    // Handles go through a slot table, which lets removal swap the last ball into the hole.
+    // Not thread safe, the owner serializes access.
+    class BallStore
+    {
+    private:
+        static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t dense;      // index into the component arrays while alive, next free slot otherwise
+            uint32_t generation; // bumped on removal so old handles stop matching
+        };
+
+        // components, dense, cache aligned for the parallel update
+        AlignedVector<float> m_x;
+        AlignedVector<float> m_y;
+        AlignedVector<float> m_radius;
+        AlignedVector<float> m_vx; // pixels per second
+        AlignedVector<float> m_vy;
+        std::vector<ALLEGRO_COLOR> m_color;
+        std::vector<uint32_t> m_owner; // dense index -> slot
+
+        std::vector<Slot> m_slots;
+        uint32_t m_free_slot = NO_SLOT;
+
+        uint64_t m_layout_version = 0; // bumped whenever balls are added, removed or reordered
+
+        BallCollider m_collider;
+        float m_width = 0; // bounds of the last update
+        float m_height = 0;
+
+    public:
+        // random size, speed, direction and colour
+        BallHandle spawn(float x, float y);
+        BallHandle spawn(float x, float y, float radius, vec2f velocity, ALLEGRO_COLOR color);
+
+        // false if the handle is stale
+        bool remove(BallHandle handle);
+        bool alive(BallHandle handle) const;
+
+        void reserve(size_t count);
+        void clear();
+
+        size_t size() const
+        {
+            return m_x.size();
+        }
+
+        bool empty() const
+        {
+            return m_x.empty();
+        }
+
+        // changes whenever the set or order of balls changes, positions moving does not count
+        uint64_t layoutVersion() const
+        {
+            return m_layout_version;
+        }
+
+        // dense component arrays, size() entries each, invalidated by spawn/remove/clear
+        const float *x() const
+        {
+            return m_x.data();
+        }
+
+        const float *y() const
+        {
+            return m_y.data();
+        }
+
+        const float *radius() const
+        {
+            return m_radius.data();
+        }
+
+        const ALLEGRO_COLOR *color() const
+        {
+            return m_color.data();
+        }
+
+        // move every ball, bounce it off the view bounds (BallPhysics) and off the other balls (BallCollider).
+        // Split into chunks across `scheduler`, bit identical for any thread count.
+        void update(float width, float height, float delta_t, TaskScheduler &scheduler = TaskScheduler::instance());
+
+        // topmost ball containing the point, an invalid handle if there is none
+        BallHandle pick(float x, float y);
+    };
+}
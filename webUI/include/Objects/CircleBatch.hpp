@@ -0,0 +1,85 @@
+#pragma once
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace WUI
+{
+    // parallel arrays of `count` circles to draw
+    struct Circles
+    {
+        const float *x = nullptr;
+        const float *y = nullptr;
+        const float *radius = nullptr;
+        const ALLEGRO_COLOR *color = nullptr;
+        size_t count = 0;
+
+        // has to change whenever count, radii or order change, see BallStore::layoutVersion
+        uint64_t layout_version = 0;
+    };
+
+    // Draws many filled circles (all balls) with a single indexed draw call.
+    // Each circle is a fan of a cached unit circle mesh, the level of detail is picked from the radius.
+    // Vertices are rebuilt every frame straight into a persistent streaming vertex buffer, indices only
+    // when the ball layout changes. Targets without vertex buffer support (memory bitmaps) get the
+    // same batch from client memory through al_draw_indexed_prim.
+    class CircleBatch
+    {
+    private:
+        // segment counts, a circle uses the smallest one that stays within MAX_ERROR of the true outline
+        static constexpr int LOD_SEGMENTS[] = {8, 12, 16, 24, 32, 48, 64};
+        static constexpr int LOD_COUNT = sizeof(LOD_SEGMENTS) / sizeof(LOD_SEGMENTS[0]);
+        static constexpr float MAX_ERROR = 0.5f; // pixels
+
+        struct UnitCircle
+        {
+            std::vector<float> cos;
+            std::vector<float> sin;
+        };
+        UnitCircle m_lods[LOD_COUNT];
+
+        // per circle, rebuilt with the layout
+        std::vector<uint8_t> m_ball_lod;
+        std::vector<int> m_indices;
+        int m_vertex_count = 0;
+        uint64_t m_layout_version = UINT64_MAX;
+
+        // gpu side, NULL when not available
+        ALLEGRO_VERTEX_BUFFER *m_vertex_buffer = NULL;
+        ALLEGRO_INDEX_BUFFER *m_index_buffer = NULL;
+        int m_vertex_capacity = 0;
+        int m_index_capacity = 0;
+        bool m_indices_uploaded = false;
+        bool m_buffers_unsupported = false;
+
+        // client side fallback
+        std::vector<ALLEGRO_VERTEX> m_vertices;
+
+    public:
+        CircleBatch();
+        ~CircleBatch();
+
+        CircleBatch(const CircleBatch &) = delete;
+        CircleBatch &operator=(const CircleBatch &) = delete;
+
+        // onto the current target, render thread only
+        void draw(const Circles &circles);
+
+        // drop the gpu buffers, has to happen before the display they belong to is destroyed
+        void release();
+
+        int getVertexCount() const
+        {
+            return m_vertex_count;
+        }
+
+    private:
+        static int lodFor(float radius);
+
+        void rebuildLayout(const Circles &circles);
+        bool ensureBuffers();
+        void writeVertices(const Circles &circles, ALLEGRO_VERTEX *out) const;
+    };
+}
@@ -5,6 +5,18 @@ namespace WUI
     class Renderable
     {
     public:
+        // Per frame state, run on worker threads before the render calls and possibly alongside other
+        // renderables' updates. Nothing is drawn here, all Allegro calls stay on the display thread in render.
+        virtual void update(const size_t displayWidth, const size_t displayHeight, const double delta_t)
+        {
+        }
+
         virtual void render(const size_t displayWidth, const size_t displayHeight, const double delta_t) = 0;
+
+        // false if the object looks the same next frame, the renderer goes idle once nothing animates
+        virtual bool isAnimating() const
+        {
+            return true;
+        }
     };
 }
\ No newline at end of file
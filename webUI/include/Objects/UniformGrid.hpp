@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace WUI
+{
+    // Broadphase over points (ball centers) in [0, width] x [0, height].
+    // Built by counting sort into persistent buffers, so a rebuild is two linear passes and never allocates
+    // once the buffers have grown. With the cell size at least the largest diameter every pair of touching
+    // balls lies in the same or in neighbouring cells.
+    class UniformGrid
+    {
+    private:
+        float m_cell_size = 1;
+        float m_inv_cell_size = 1;
+        int m_cols = 1;
+        int m_rows = 1;
+
+        std::vector<uint32_t> m_cell_start; // first entry of each cell in m_order, cols * rows + 1
+        std::vector<uint32_t> m_order;      // point indices sorted by cell, ascending inside a cell
+        std::vector<uint32_t> m_cell_of;    // cell of each point
+        std::vector<uint32_t> m_position;   // where each point ended up in m_order
+
+    public:
+        void build(const float *x, const float *y, size_t count, float cell_size, float width, float height);
+
+        float getCellSize() const
+        {
+            return m_cell_size;
+        }
+
+        size_t getCellCount() const
+        {
+            return (size_t)m_cols * m_rows;
+        }
+
+        int cellX(float x) const
+        {
+            return std::min(std::max((int)(x * m_inv_cell_size), 0), m_cols - 1);
+        }
+
+        int cellY(float y) const
+        {
+            return std::min(std::max((int)(y * m_inv_cell_size), 0), m_rows - 1);
+        }
+
+        // point indices sorted by cell, entries [cellStart(c), cellStart(c + 1)) are cell c
+        const uint32_t *order() const
+        {
+            return m_order.data();
+        }
+
+        // inverse of order(), the position of every point in it
+        const uint32_t *positions() const
+        {
+            return m_position.data();
+        }
+
+        uint32_t cellStart(size_t cell) const
+        {
+            return m_cell_start[cell];
+        }
+
+        // Calls fn(k) for every point in the 3x3 cells around (x, y), in a fixed order. k is the position in
+        // order(), so data gathered into grid order can be read directly. Returning false from fn stops the walk.
+        template <typename Fn>
+        void forEachNear(float x, float y, Fn &&fn) const
+        {
+            const int cx = cellX(x);
+            const int cy = cellY(y);
+
+            for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, m_rows - 1); ny++)
+            {
+                // the cells of one row are adjacent in m_order
+                const size_t row = (size_t)ny * m_cols;
+                const uint32_t begin = m_cell_start[row + std::max(cx - 1, 0)];
+                const uint32_t end = m_cell_start[row + std::min(cx + 1, m_cols - 1) + 1];
+
+                for (uint32_t k = begin; k < end; k++)
+                {
+                    if (!fn(k))
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+    };
+}
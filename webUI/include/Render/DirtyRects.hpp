@@ -0,0 +1,25 @@
+#pragma once
+#include <vector>
+
+#include <include/cef_render_handler.h>
+
+namespace WUI
+{
+    // Helpers for the damage rect lists CEF hands to OnPaint
+    namespace DirtyRects
+    {
+        // dirty rects closer than this many pixels are merged into a single lock
+        const int MERGE_SLACK = 16;
+
+        // empty rect (0 size) if they do not overlap
+        CefRect intersect(const CefRect &a, const CefRect &b);
+        // bounding box of both
+        CefRect unite(const CefRect &a, const CefRect &b);
+        // true if the rects overlap or are less than `slack` pixels apart
+        bool touch(const CefRect &a, const CefRect &b, int slack);
+
+        // Merge overlapping or nearly touching dirty rects so every region only needs one lock.
+        // Rects are clipped to the given bounds first, empty ones are dropped.
+        void merge(std::vector<CefRect> &rects, const CefRect &bounds, int slack = MERGE_SLACK);
+    }
+}
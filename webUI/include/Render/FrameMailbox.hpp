@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <include/cef_render_handler.h>
+
+#include "Render/PixelConvert.hpp"
+#include "Render/ResizePolicy.hpp"
+#include "util/triple_buffer.hpp"
+
+namespace WUI
+{
+    // One persistent staging buffer, already converted into the OSR bitmap layout
+    struct StagingFrame
+    {
+        std::vector<uint8_t> pixels; // sized for capacity, not for the frame, rows are `pitch` apart
+        int width = 0;
+        int height = 0;
+        ptrdiff_t pitch = 0; // bytes per row
+        ResizePolicy capacity; // producer only
+
+        // regions that changed since the last frame the consumer took, only these are valid in `pixels`
+        std::vector<CefRect> damage;
+        uint64_t sequence = 0;
+        uint32_t marker = UINT32_MAX; // latency marker the paint showed, see LatencyProbe
+        uint64_t epoch = 0;           // FrameMailbox::epoch() when it was published
+    };
+
+    // Hands CEF paints over to the render loop without locks.
+    // The CEF UI thread converts the damaged regions of every paint into its private staging buffer and publishes it,
+    // the render loop picks up the newest complete frame whenever it draws.
+    // Whether a frame was skipped by the render loop is only known one publish later, so every frame also carries
+    // the damage of its predecessor (and further back while frames keep getting skipped).
+    class FrameMailbox
+    {
+    private:
+        TripleBuffer<StagingFrame> m_frames;
+
+        // BGRA -> staging layout, has to match the format the staging data is uploaded with
+        PixelConvert::BlockFn m_convert = PixelConvert::bgraToRgba;
+
+        // producer state
+        std::vector<CefRect> m_last_dirty;  // what CEF reported for the previous frame
+        std::vector<CefRect> m_last_damage; // what the previous frame was published with
+        bool m_last_skipped = false;        // the frame before the previous one was never taken
+        int m_last_width = 0;
+        int m_last_height = 0;
+        uint64_t m_sequence = 0;
+        bool m_pooled = true;
+
+        std::atomic<uint64_t> m_epoch{0}; // bumped by discard, written by the producer only
+
+        std::atomic<uint64_t> m_skipped_frames{0};
+        std::atomic<uint64_t> m_reallocations{0};
+        std::atomic<size_t> m_staging_bytes{0}; // of all three slots
+
+    public:
+        // set before the first publish, not synchronized.
+        // Unpooled staging buffers are reallocated to the exact size on every size change.
+        void setPooled(bool pooled)
+        {
+            m_pooled = pooled;
+        }
+
+        // set before the first publish, not synchronized
+        void setConversion(PixelConvert::BlockFn convert)
+        {
+            m_convert = convert;
+        }
+
+        // CEF thread: copy the damaged parts of a BGRA paint buffer and publish them, `marker` travels along
+        void publish(const void *buffer, int width, int height, std::vector<CefRect> damage, uint32_t marker = UINT32_MAX);
+
+        // CEF thread: the next publish carries its whole frame, for when nothing the consumer holds is valid anymore
+        void resetDamage()
+        {
+            m_last_width = 0;
+            m_last_height = 0;
+        }
+
+        // CEF thread: whatever was published so far is dropped by acquire, even if it was never taken,
+        // and the next publish carries its whole frame
+        void discard()
+        {
+            m_epoch.fetch_add(1, std::memory_order_release);
+            resetDamage();
+        }
+
+        // any thread: frames published since the last discard carry this epoch
+        uint64_t epoch() const
+        {
+            return m_epoch.load(std::memory_order_acquire);
+        }
+
+        // render thread: latest published frame or nullptr if there is nothing new (or only discarded frames),
+        // stays valid until the next call
+        const StagingFrame *acquire();
+
+        uint64_t skippedFrames() const
+        {
+            return m_skipped_frames;
+        }
+
+        // staging buffer reallocations so far, any thread
+        uint64_t reallocations() const
+        {
+            return m_reallocations;
+        }
+
+        // bytes held by the staging buffers, any thread
+        size_t stagingBytes() const
+        {
+            return m_staging_bytes;
+        }
+    };
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace WUI
+{
+    // Single frame pacing source for the engine timer and the CEF windowless frame rate.
+    // The UI always runs at an integer fraction of the engine rate so both clocks stay in phase.
+    // Render and paint cost is tracked against the frame budget: when a frame runs over, the UI rate is lowered
+    // (and UI uploads are skipped on the frames in between), once there is headroom again it recovers step by step.
+    class FramePacer
+    {
+    private:
+        static constexpr int MIN_UI_FPS = 10;
+        static constexpr double EWMA_WEIGHT = 0.1;
+        static constexpr double OVER_BUDGET = 0.9;  // of the budget, start throttling the UI
+        static constexpr double UNDER_BUDGET = 0.6; // of the budget, allowed to recover
+
+        const int m_engine_fps;
+        std::atomic<int> m_ui_divisor{1}; // written by the render thread, uiFps() is read from anywhere
+
+        double m_frame_cost = 0; // smoothed seconds of render + paint work per frame
+        std::atomic<int64_t> m_paint_cost_ns{0}; // paints since the last frame, written by the CEF thread
+
+        uint64_t m_frame_index = 0;
+        int m_frames_since_change = 0;
+
+    public:
+        FramePacer(int engine_fps);
+
+        int engineFps() const
+        {
+            return m_engine_fps;
+        }
+
+        int uiFps() const
+        {
+            return m_engine_fps / m_ui_divisor.load(std::memory_order_relaxed);
+        }
+
+        double budget() const
+        {
+            return 1.0 / m_engine_fps;
+        }
+
+        double frameCost() const
+        {
+            return m_frame_cost;
+        }
+
+        // CEF thread: time spent handling one OnPaint
+        void addPaintCost(double seconds)
+        {
+            m_paint_cost_ns.fetch_add((int64_t)(seconds * 1e9), std::memory_order_relaxed);
+        }
+
+        // render thread: whether this frame should pick up a new UI frame, false on the frames
+        // in between UI ticks while the UI is throttled
+        bool shouldUploadUi() const
+        {
+            return m_frame_index % m_ui_divisor.load(std::memory_order_relaxed) == 0;
+        }
+
+        // render thread: account one presented frame, true if the UI rate changed
+        bool endFrame(double render_seconds);
+    };
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <allegro5/allegro.h>
+
+#include <atomic>
+#include <cstdint>
+
+// posted into the render loop when something got invalidated while it was idle
+#define WUI_EVENT_FRAME_DAMAGE ALLEGRO_GET_EVENT_TYPE('W', 'U', 'I', 'D')
+
+namespace WUI
+{
+    // reasons a new frame has to be presented
+    enum DamageSource : uint32_t
+    {
+        DAMAGE_NONE = 0,
+        DAMAGE_UI_FRAME = 1 << 0, // CEF published a new paint
+        DAMAGE_ANIMATION = 1 << 1, // scene content changed outside of the render loop (objects added, ...)
+        DAMAGE_RESIZE = 1 << 3,
+        DAMAGE_EXPOSE = 1 << 4, // display contents were lost or need to be shown the first time
+    };
+
+    // Collects damage from any thread so the render loop only presents when something changed.
+    // The first invalidation after the render loop consumed everything emits a WUI_EVENT_FRAME_DAMAGE
+    // to wake it up, further ones are coalesced into the pending mask.
+    class FrameScheduler
+    {
+    private:
+        std::atomic<uint32_t> m_damage{DAMAGE_EXPOSE};
+        ALLEGRO_EVENT_SOURCE m_event_source;
+
+    public:
+        FrameScheduler();
+        ~FrameScheduler();
+
+        ALLEGRO_EVENT_SOURCE *getEventSource()
+        {
+            return &m_event_source;
+        }
+
+        // any thread
+        void invalidate(uint32_t sources);
+
+        // render thread: everything invalidated since the last call
+        uint32_t consume()
+        {
+            return m_damage.exchange(DAMAGE_NONE, std::memory_order_acq_rel);
+        }
+
+        bool pending() const
+        {
+            return m_damage.load(std::memory_order_relaxed) != DAMAGE_NONE;
+        }
+    };
+}
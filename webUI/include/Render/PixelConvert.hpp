@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "util/cpu_isa.hpp"
+
+namespace WUI
+{
+    // Conversion of CEF paint buffers (BGRA bytes) into the RGBA_8888 layout the OSR bitmap is locked with.
+    // ALLEGRO_PIXEL_FORMAT_RGBA_8888 is packed, so in memory (little endian) it is A B G R.
+    namespace PixelConvert
+    {
+        // converts or copies a whole block, see bgraToRgba and copy
+        typedef void (*BlockFn)(uint8_t *dst, ptrdiff_t dst_pitch,
+                                const uint8_t *src, ptrdiff_t src_pitch,
+                                int width, int height);
+
+        // converts `pixels` pixels of a single row, dst and src may be unaligned but must not overlap
+        typedef void (*RowKernel)(uint8_t *dst, const uint8_t *src, size_t pixels);
+
+        // Convert a width x height block. Pitches are in bytes and may be larger than width * 4
+        // (sub rects of a larger buffer) or negative (bottom up locked regions).
+        void bgraToRgba(uint8_t *dst, ptrdiff_t dst_pitch,
+                        const uint8_t *src, ptrdiff_t src_pitch,
+                        int width, int height);
+
+        // Plain copy of a width x height block of 4 byte pixels that already is in the destination layout
+        void copy(uint8_t *dst, ptrdiff_t dst_pitch,
+                  const uint8_t *src, ptrdiff_t src_pitch,
+                  int width, int height);
+
+        // isa of the kernel bgraToRgba uses
+        Isa activeIsa();
+
+        // kernel for a specific isa, nullptr if it was not compiled in
+        RowKernel rowKernel(Isa isa);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace WUI
+{
+    // Capacity of a pixel buffer that follows the view size.
+    // Growing rounds up with headroom so a window being drag-resized reallocates a handful of times instead of on
+    // every step. Shrinking waits until the view stayed well below the capacity for a while, a drag that goes
+    // back and forth keeps its buffer.
+    class ResizePolicy
+    {
+    public:
+        static constexpr int ALIGNMENT = 64;        // pixels, capacities are multiples of this
+        static constexpr double HEADROOM = 1.25;    // of the requested size, added on growth
+        static constexpr double SHRINK_AREA = 0.5;  // view area below this fraction of the capacity is oversized
+        static constexpr double SHRINK_DELAY = 2.0; // seconds the buffer has to stay oversized before it shrinks
+
+    private:
+        bool m_pooled = true; // false: every size change reallocates to the exact size
+        int m_max_size = 0;   // headroom stops here, 0 = no limit
+        int m_width = 0;
+        int m_height = 0;
+        double m_oversized_since = -1;
+        uint64_t m_reallocations = 0;
+
+    public:
+        explicit ResizePolicy(bool pooled = true)
+            : m_pooled(pooled)
+        {
+        }
+
+        void setPooled(bool pooled)
+        {
+            m_pooled = pooled;
+        }
+
+        // largest width or height the buffer can be created with, the headroom is cut there but the view never is
+        void setMaxSize(int max_size)
+        {
+            m_max_size = max_size;
+        }
+
+        // the buffer is `width` x `height` regardless of the policy, when what fit() asked for could not be allocated
+        void setCapacity(int width, int height)
+        {
+            m_width = width;
+            m_height = height;
+            m_oversized_since = -1;
+        }
+
+        // Whether the buffer has to be reallocated at capacityWidth() x capacityHeight() to hold a `width` x `height`
+        // view. `now` is in seconds, the shrink delay only runs out when this is called again later.
+        bool fit(int width, int height, double now);
+
+        int capacityWidth() const
+        {
+            return m_width;
+        }
+
+        int capacityHeight() const
+        {
+            return m_height;
+        }
+
+        size_t capacityBytes(size_t pixel_size = 4) const
+        {
+            return (size_t)m_width * m_height * pixel_size;
+        }
+
+        uint64_t reallocations() const
+        {
+            return m_reallocations;
+        }
+    };
+}
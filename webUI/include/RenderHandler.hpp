@@ -7,9 +7,20 @@
 #include <include/cef_app.h>
 #include <include/cef_client.h>
 #include <include/cef_render_handler.h>
+#include <chrono>
+#include <functional>
 #include <mutex>
 
+#include "Input/LatencyProbe.hpp"
+#include "Objects/BallSimulation.hpp"
+#include "Objects/CircleBatch.hpp"
 #include "Objects/Renderable.hpp"
+#include "Render/FrameMailbox.hpp"
+#include "Render/FramePacer.hpp"
+#include "Render/FrameScheduler.hpp"
+#include "Render/ResizePolicy.hpp"
+#include "util/aligned_vector.hpp"
+#include "util/mpsc_queue.hpp"
 
 namespace WUI
 {
@@ -17,11 +28,57 @@ namespace WUI
     const size_t BASE_WIDTH = 640;
     const size_t BASE_HEIGHT = 480;
 
+    // How CEF paints get into the OSR bitmap
+    enum class OsrUploadMode
+    {
+        Native,     // bitmap uses CEF's BGRA byte order, paints are plain row copies
+        Converting, // bitmap is RGBA_8888, paints are swizzled on the CEF thread
+    };
+
+    // construction options for the RenderHandler
+    struct RenderSettings
+    {
+        int fps = BASE_FPS;
+        int width = BASE_WIDTH;
+        int height = BASE_HEIGHT;
+        bool vsync = false;
+        // render into a memory bitmap instead of a display, for machines without a desktop session
+        bool headless = false;
+        // allow the OSR bitmap to use CEF's byte order, false forces the converting upload
+        bool native_osr_format = true;
+        // the user can resize the window, the view follows it
+        bool resizable = true;
+        // OSR and staging buffers grow with headroom and shrink late, false reallocates them on every size change
+        bool pooled_resize = true;
+    };
+
+    // where the last renderFrame spent its time, in seconds
+    struct FrameTimings
+    {
+        double renderables = 0;
+        double upload = 0;
+        double draw_ui = 0;
+        double flip = 0;
+        size_t upload_bytes = 0;
+    };
+
+    // what resizing the view cost so far
+    struct ResizeStats
+    {
+        uint64_t resizes = 0;
+        uint64_t osr_reallocations = 0;
+        uint64_t staging_reallocations = 0;
+        uint64_t stale_frames = 0; // painted for a size the view no longer had, dropped
+        size_t osr_bytes = 0;
+        size_t staging_bytes = 0;
+    };
+
     class RenderHandler : public CefRenderHandler
     {
     private:
         // Required always
         ALLEGRO_DISPLAY *m_display = NULL;
+        ALLEGRO_BITMAP *m_headless_target = NULL; // replaces the display backbuffer when running headless
 
         // Required for rendering
         ALLEGRO_EVENT_QUEUE *m_event_queue = NULL; // Display event loop
@@ -31,21 +88,74 @@ namespace WUI
         std::atomic<bool> m_running = false;
         std::atomic<bool> m_redraw_pending = false;
 
+        // demand driven presentation, the timer is stopped while nothing changes
+        FrameScheduler m_frame_scheduler;
+        bool m_animating = false; // some renderable moved in the last frame
+        std::chrono::steady_clock::time_point m_last_frame_time;
+        FrameTimings m_frame_timings;
+
+        // drives the engine timer and the CEF frame rate
+        FramePacer m_frame_pacer;
+        CefRefPtr<CefBrowserHost> m_browser_host;
+        std::function<void(int)> m_frame_rate_listener; // set on the CEF UI thread, called on the render thread
+        std::mutex m_frame_rate_listener_mutex;
+
+        // external CEF message pump, al_get_time() at which CefDoMessageLoopWork is due
+        static constexpr double NO_PUMP_SCHEDULED = -1;
+        double m_pump_deadline = NO_PUMP_SCHEDULED;
+
+        // size CEF lays the page out for, the display size or what a benchmark set
+        std::atomic<int> m_view_width{0};
+        std::atomic<int> m_view_height{0};
+        uint64_t m_resizes = 0;      // render thread only
+        uint64_t m_stale_frames = 0; // render thread only
+        bool m_ui_repaint = false;   // a dropped UI frame still needs a full repaint, render thread only
+
         // OSR buffer
     private:
-        ALLEGRO_BITMAP *m_osr_buffer = NULL;
-        std::mutex m_l_osr_buffer_lock;
+        ALLEGRO_BITMAP *m_osr_buffer = NULL; // capacity sized, only the top left m_ui_width x m_ui_height is the UI
+        ResizePolicy m_osr_capacity;
+        int m_osr_format = ALLEGRO_PIXEL_FORMAT_RGBA_8888; // format the bitmap is locked with
+        OsrUploadMode m_osr_mode = OsrUploadMode::Converting;
+        FrameMailbox m_frame_mailbox; // CEF paints -> render loop, lock free
+        std::atomic<uint64_t> m_paint_count{0};
+        bool m_ui_shown = false; // a CEF frame was uploaded, render thread only
+        int m_ui_width = 0;      // size of the last uploaded frame, render thread only
+        int m_ui_height = 0;
+
+        // <select> dropdowns and the like, CEF paints them on their own and they are drawn over the UI
+        ALLEGRO_BITMAP *m_popup_buffer = NULL; // created with the first popup paint, render thread only
+        ResizePolicy m_popup_capacity;
+        FrameMailbox m_popup_mailbox;
+        std::atomic<bool> m_popup_visible{false};
+        std::atomic<int> m_popup_x{0};
+        std::atomic<int> m_popup_y{0};
+        int m_popup_width = 0; // size of the last uploaded popup frame, render thread only
+        int m_popup_height = 0;
+        uint64_t m_popup_epoch = 0; // mailbox epoch of the last uploaded popup frame, render thread only
+
+        LatencyProbe *m_latency_probe = nullptr;
+        uint32_t m_ui_marker = LatencyProbe::NO_MARKER; // of the UI frame in the OSR bitmap, render thread only
         cef_color_t m_background_color = 0; // if alpha is 0 then it is transparent
 
     private:
         // game management which is not supposed to be here technically
-        std::mutex m_l_renderables;
+        // heterogeneous, rarely used objects, render thread only. Other threads queue changes.
+        struct RenderableCommand
+        {
+            std::shared_ptr<Renderable> renderable;
+            bool remove = false;
+        };
+        MpscQueue<RenderableCommand> m_renderable_commands;
         std::vector<std::shared_ptr<Renderable>> m_renderables;
 
+        // balls run on their own fixed tick, frames draw the newest tick interpolated to the present
+        BallSimulation m_simulation;
+        CircleBatch m_ball_batch;              // render thread only
+        AlignedVector<float> m_ball_x, m_ball_y; // interpolated positions, render thread only
+
        public:
-        RenderHandler(const int &FPS = BASE_FPS,
-                      const int &width = BASE_WIDTH,
-                      const int &height = BASE_HEIGHT);
+        RenderHandler(const RenderSettings &settings = RenderSettings());
         ~RenderHandler();
 
         // FrameListener interface
@@ -53,13 +163,97 @@ namespace WUI
         void renderLoop();
         ALLEGRO_DISPLAY *getDisplay() const;
 
+        // draw and present one frame, render thread only.
+        // The render loop calls this on demand, benchmarks drive it directly.
+        void renderFrame(double delta_s);
+
+        const FrameTimings &getLastFrameTimings() const
+        {
+            return m_frame_timings;
+        }
+
+        // size of the view CEF paints, follows the display
+        int getViewWidth() const;
+        int getViewHeight() const;
+
+        // render thread: the display was resized (or a benchmark pretends it was). CEF is told right away,
+        // the OSR bitmap catches up on the next frame. Headless the target bitmap keeps its size.
+        void resizeView(int width, int height);
+
+        // render thread, or once the render loop ended
+        ResizeStats getResizeStats() const;
+
         void shutdown();
 
+        // request a new frame, any thread
+        void invalidate(uint32_t sources)
+        {
+            m_frame_scheduler.invalidate(sources);
+        }
+
+        // browser whose windowless frame rate follows the pacer
+        void setBrowserHost(CefRefPtr<CefBrowserHost> browser_host);
+
+        // called with the UI frame rate whenever the pacer changes it and with the current one by setBrowserHost,
+        // on the render or CEF UI thread
+        void setFrameRateListener(std::function<void(int)> listener);
+
+        int getUiFrameRate() const
+        {
+            return m_frame_pacer.uiFps();
+        }
+
+        // wake the render loop for CEF work through this source (see BrowserApp)
+        void attachMessagePump(ALLEGRO_EVENT_SOURCE *pump_event_source);
+
+        OsrUploadMode getOsrUploadMode() const
+        {
+            return m_osr_mode;
+        }
+
+        // stamp paints and flips for input to photon latency, set before the browser is created
+        void setLatencyProbe(LatencyProbe *probe)
+        {
+            m_latency_probe = probe;
+        }
+
+        // OnPaint calls so far, any thread
+        uint64_t getPaintCount() const
+        {
+            return m_paint_count.load(std::memory_order_relaxed);
+        }
+
+    private:
+        void schedulePumpWork(int64_t delay_ms);
+
+        // push the pacer's rates to the allegro timer and CEF
+        void applyFrameRates();
+
+        // add and remove what other threads queued since the last frame
+        void applyRenderableCommands();
+
+        // create the OSR bitmap in the best format the display accepts, sets m_osr_format and m_osr_mode
+        bool createOsrBuffer(int width, int height, bool allow_native);
+
+        // move `bitmap` to the size `capacity` asks for, its top left `keep_width` x `keep_height` is carried over.
+        // Created like the OSR bitmap when there is none yet.
+        bool reallocateBitmap(ALLEGRO_BITMAP *&bitmap, const ResizePolicy &capacity, int &keep_width, int &keep_height);
+
+        // fit `capacity` to `width` x `height` and reallocate `bitmap` if it asks for that, at the exact size if the
+        // padded one fails. False if `bitmap` cannot hold `width` x `height`, it keeps its old size then.
+        bool fitBitmap(ALLEGRO_BITMAP *&bitmap, ResizePolicy &capacity, int width, int height, int &keep_width, int &keep_height);
+
+        // copy the damaged regions of a staged frame into `bitmap`, render thread only, returns bytes written
+        size_t uploadFrame(ALLEGRO_BITMAP *bitmap, const StagingFrame &frame);
+
         // CefRenderHandler interface
     public: // OSR CEF stuff
         virtual void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect &rect);
 
         virtual void OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList &dirtyRects, const void *buffer, int width, int height);
+
+        virtual void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show);
+        virtual void OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect &rect);
         // CefBase interface
 
         inline bool IsTransparent() const
@@ -72,11 +266,41 @@ namespace WUI
 
         // object management
     public:
+        // Object changes from any thread never wait on the render loop, they are queued and applied
+        // at the start of the next frame (balls: the next simulation tick).
+
         void addObject(std::shared_ptr<Renderable> renderable)
         {
-            m_l_renderables.lock();
-            m_renderables.push_back(renderable);
-            m_l_renderables.unlock();
+            m_renderable_commands.push({std::move(renderable), false});
+            m_frame_scheduler.invalidate(DAMAGE_ANIMATION);
+        }
+
+        void removeObject(std::shared_ptr<Renderable> renderable)
+        {
+            m_renderable_commands.push({std::move(renderable), true});
+            m_frame_scheduler.invalidate(DAMAGE_ANIMATION);
+        }
+
+        void spawnBall(float x, float y)
+        {
+            m_simulation.spawn(x, y);
+        }
+
+        // a single queued command however many positions there are
+        void spawnBalls(std::vector<vec2f> positions)
+        {
+            m_simulation.spawn(std::move(positions));
+        }
+
+        void removeBall(BallHandle handle)
+        {
+            m_simulation.remove(handle);
+        }
+
+        // see BallSimulation::pick
+        std::future<BallHandle> pickBall(float x, float y)
+        {
+            return m_simulation.pick(x, y);
         }
     };
 
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <include/cef_render_process_handler.h>
+#include <include/cef_v8.h>
+
+#include "Bus/BusCodec.hpp"
+#include "Bus/SharedData.hpp"
+
+namespace WUI
+{
+    // Page side of the event bus (the engine side is EventBus), lives in the render process.
+    // The main frame gets a `window.wui` object:
+    //
+    //   const id = wui.subscribe('engine.balls', value => ...); // also called right away with the last state value
+    //   wui.unsubscribe(id);
+    //   wui.publish('ui.increment', 1); // null, booleans, numbers and strings
+    //   wui.data('minimap');            // latest DataChannels snapshot or null
+    //
+    // Publishes are collected and sent as one CefProcessMessage per task turn of the renderer thread.
+    // Everything here runs on the renderer main thread, so nothing is locked.
+    class RenderProcessHandler : public CefRenderProcessHandler, public CefV8Handler
+    {
+    private:
+        CefRefPtr<CefV8Context> m_context; // main frame, null between pages
+
+        std::unordered_map<std::string, std::vector<std::pair<uint32_t, CefRefPtr<CefV8Value>>>> m_subscribers;
+        std::unordered_map<std::string, Bus::Value> m_state; // FLAG_STATE values, replayed on subscribe
+        uint32_t m_next_subscription = 1;
+
+        Bus::BatchWriter m_outgoing;
+        bool m_flush_scheduled = false;
+
+        // latest shared memory snapshot per DataChannels channel, the V8 object is made on first access
+        struct DataSnapshot
+        {
+            CefRefPtr<CefSharedMemoryRegion> region;
+            Bus::DataHeader header;
+            CefRefPtr<CefV8Value> object;
+        };
+        std::unordered_map<std::string, DataSnapshot> m_data;
+
+    public:
+        // CefRenderProcessHandler interface
+        virtual void OnContextCreated(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context) override;
+        virtual void OnContextReleased(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context) override;
+        virtual bool OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message) override;
+
+        // CefV8Handler interface, the window.wui functions
+        virtual bool Execute(const CefString &name, CefRefPtr<CefV8Value> object, const CefV8ValueList &arguments, CefRefPtr<CefV8Value> &retval, CefString &exception) override;
+
+        // send what the page published so far
+        void flush();
+
+    private:
+        void deliver(const std::string &topic, const Bus::Value &value);
+        void receiveData(CefRefPtr<CefProcessMessage> message);
+        CefRefPtr<CefV8Value> dataObject(DataSnapshot &snapshot);
+
+        IMPLEMENT_REFCOUNTING(RenderProcessHandler);
+    };
+}
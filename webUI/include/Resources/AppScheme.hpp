@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <include/cef_scheme.h>
+
+#include "Resources/ResourcePack.hpp"
+
+namespace WUI
+{
+    // app://ui/<path> serves <path> out of a ResourcePack
+    static const char *const APP_SCHEME = "app";
+    static const char *const APP_ORIGIN = "app://ui/";
+
+    // every process, from CefApp::OnRegisterCustomSchemes
+    void registerAppScheme(CefRawPtr<CefSchemeRegistrar> registrar);
+
+    // browser process after CefInitialize, false if `pack_path` is not a usable pack
+    bool installAppScheme(const std::string &pack_path);
+
+    class AppSchemeHandlerFactory : public CefSchemeHandlerFactory
+    {
+    private:
+        std::shared_ptr<const ResourcePack> m_pack;
+
+    public:
+        explicit AppSchemeHandlerFactory(std::shared_ptr<const ResourcePack> pack)
+            : m_pack(pack)
+        {
+        }
+
+        // IO thread
+        virtual CefRefPtr<CefResourceHandler> Create(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, const CefString &scheme_name, CefRefPtr<CefRequest> request) override;
+
+        IMPLEMENT_REFCOUNTING(AppSchemeHandlerFactory);
+    };
+
+    // One request. Reads copy straight from the mapping into CEF's buffer, there is no intermediate one.
+    class PackResourceHandler : public CefResourceHandler
+    {
+    private:
+        std::shared_ptr<const ResourcePack> m_pack; // keeps the mapping alive
+        const PackedResource *m_resource;           // null = 404
+        size_t m_offset = 0;
+
+    public:
+        PackResourceHandler(std::shared_ptr<const ResourcePack> pack, const PackedResource *resource)
+            : m_pack(pack), m_resource(resource)
+        {
+        }
+
+        // CefResourceHandler interface
+        virtual bool Open(CefRefPtr<CefRequest> request, bool &handle_request, CefRefPtr<CefCallback> callback) override;
+        virtual void GetResponseHeaders(CefRefPtr<CefResponse> response, int64_t &response_length, CefString &redirectUrl) override;
+        virtual bool Skip(int64_t bytes_to_skip, int64_t &bytes_skipped, CefRefPtr<CefResourceSkipCallback> callback) override;
+        virtual bool Read(void *data_out, int bytes_to_read, int &bytes_read, CefRefPtr<CefResourceReadCallback> callback) override;
+        virtual void Cancel() override
+        {
+        }
+
+        IMPLEMENT_REFCOUNTING(PackResourceHandler);
+    };
+}
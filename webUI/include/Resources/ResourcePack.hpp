@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace WUI
+{
+    // one file inside a ResourcePack, points straight into the mapping
+    struct PackedResource
+    {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        const char *mime_type = "application/octet-stream";
+        bool gzip = false; // stored compressed, served with Content-Encoding: gzip
+    };
+
+    // Read only view of an archive built by cmake/pack_resources.cmake.
+    // The file is mapped once, serving a resource never touches the filesystem again.
+    class ResourcePack
+    {
+    private:
+        const uint8_t *m_mapping = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void *m_file = nullptr;
+        void *m_file_mapping = nullptr;
+#endif
+        std::unordered_map<std::string, PackedResource> m_resources;
+
+    public:
+        ResourcePack() = default;
+        ~ResourcePack();
+
+        ResourcePack(const ResourcePack &) = delete;
+        ResourcePack &operator=(const ResourcePack &) = delete;
+
+        // false if the file is missing or not a complete pack
+        bool open(const std::string &path);
+        void close();
+
+        bool isOpen() const
+        {
+            return m_mapping != nullptr;
+        }
+
+        // `path` relative to the packed directory, "css/main.css"; null if it is not in the pack
+        const PackedResource *find(const std::string &path) const;
+
+        size_t count() const
+        {
+            return m_resources.size();
+        }
+
+        // by file extension, octet-stream for anything unknown
+        static const char *mimeType(const std::string &path);
+
+    private:
+        bool parseIndex();
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <include/cef_trace.h>
+
+namespace WUI
+{
+
+    // One --trace recording: engine spans (util/trace.hpp) and CEF's own trace, written into a single
+    // Chrome trace file so both timelines line up. UI thread only.
+    class TraceSession : public CefEndTracingCallback
+    {
+    private:
+        std::string m_path;
+        std::atomic<bool> m_written{false};
+
+    public:
+        explicit TraceSession(const std::string &path);
+
+        // after CefInitialize
+        void begin();
+
+        // Stop recording and write the file. Pumps CEF until it delivered its part of the trace,
+        // so this has to run before CefShutdown.
+        void end();
+
+        // CefEndTracingCallback interface
+        virtual void OnEndTracingComplete(const CefString &tracing_file) override;
+
+        IMPLEMENT_REFCOUNTING(TraceSession);
+    };
+}
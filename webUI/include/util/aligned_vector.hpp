@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace WUI
+{
+    static constexpr size_t CACHE_LINE = 64;
+
+    // Allocator starting every buffer on a cache line. Parallel loops split arrays at multiples of
+    // CACHE_LINE / sizeof(T) elements, so no two threads ever write into the same line.
+    template <typename T>
+    struct CacheAlignedAllocator
+    {
+        typedef T value_type;
+
+        CacheAlignedAllocator() = default;
+
+        template <typename U>
+        CacheAlignedAllocator(const CacheAlignedAllocator<U> &)
+        {
+        }
+
+        T *allocate(size_t count)
+        {
+            return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(CACHE_LINE)));
+        }
+
+        void deallocate(T *pointer, size_t)
+        {
+            ::operator delete(pointer, std::align_val_t(CACHE_LINE));
+        }
+
+        template <typename U>
+        bool operator==(const CacheAlignedAllocator<U> &) const
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const CacheAlignedAllocator<U> &) const
+        {
+            return false;
+        }
+    };
+
+    template <typename T>
+    using AlignedVector = std::vector<T, CacheAlignedAllocator<T>>;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define WUI_X86 1
+#else
+#define WUI_X86 0
+#endif
+
+// gcc and clang only emit SSSE3/AVX2 instructions for functions explicitly marked for it,
+// msvc accepts the intrinsics everywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define WUI_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WUI_TARGET(isa)
+#endif
+
+namespace WUI
+{
+    // instruction set levels the SIMD kernels are built for, picked at runtime
+    enum class Isa
+    {
+        Scalar,
+        SSSE3,
+        AVX2,
+    };
+
+    bool isaSupported(Isa isa);
+    const char *isaName(Isa isa);
+
+    // best level the running cpu supports, resolved once on first use
+    Isa bestIsa();
+}
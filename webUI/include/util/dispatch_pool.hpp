@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WUI
+{
+    // Small pool for event handlers that may block (waiting on a future, logging, ...).
+    // Jobs posted with the same key always run on the same thread in posting order, so one subscriber never
+    // sees its events overlap or arrive reordered, while different subscribers run side by side.
+    class DispatchPool
+    {
+    private:
+        struct Worker
+        {
+            std::mutex lock;
+            std::condition_variable wake;
+            std::deque<std::function<void()>> jobs;
+            bool stop = false;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+    public:
+        explicit DispatchPool(unsigned threads);
+        // runs what is already queued, then joins
+        ~DispatchPool();
+
+        DispatchPool(const DispatchPool &) = delete;
+        DispatchPool &operator=(const DispatchPool &) = delete;
+
+        void post(uint64_t key, std::function<void()> job);
+
+    private:
+        static void run(Worker &worker);
+    };
+}
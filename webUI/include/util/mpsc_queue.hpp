@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace WUI
+{
+    // Unbounded lock free multi producer / single consumer queue (Vyukov).
+    // Linking a value in is a single atomic exchange and never waits for other producers or the consumer.
+    // Nodes come from a fixed pool the consumer recycles into, taking one is a CAS on the pool's free list.
+    // Only when more than POOL_NODES values are in flight does push fall back to new, which may lock in malloc.
+    // A value whose push is still in progress may not be visible to pop yet, it shows up on a later pop.
+    template <typename T>
+    class MpscQueue
+    {
+    public:
+        static constexpr uint32_t POOL_NODES = 1024;
+
+    private:
+        static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+        struct Node
+        {
+            std::atomic<Node *> next{nullptr};
+            T value;
+            uint32_t slot = NO_NODE;                 // index in m_pool, NO_NODE for heap nodes
+            std::atomic<uint32_t> free_next{NO_NODE}; // while on the free list
+        };
+
+        std::atomic<Node *> m_head; // newest node, producers
+        Node *m_tail;               // consumed stub, its successor is the oldest value, consumer owned
+
+        std::unique_ptr<Node[]> m_pool;
+        // top of the free list as tag << 32 | slot, the tag changes with every pop so a stale CAS fails (ABA)
+        std::atomic<uint64_t> m_free{NO_NODE};
+
+    public:
+        MpscQueue()
+            : m_pool(new Node[POOL_NODES])
+        {
+            for (uint32_t slot = POOL_NODES; slot-- > 0;)
+            {
+                m_pool[slot].slot = slot;
+                release(&m_pool[slot]);
+            }
+
+            Node *stub = acquire();
+            m_head.store(stub, std::memory_order_relaxed);
+            m_tail = stub;
+        }
+
+        ~MpscQueue()
+        {
+            while (Node *node = m_tail)
+            {
+                m_tail = node->next.load(std::memory_order_relaxed);
+                if (node->slot == NO_NODE)
+                {
+                    delete node;
+                }
+            }
+        }
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+
+        // any thread
+        void push(T value)
+        {
+            Node *node = acquire();
+            node->value = std::move(value);
+
+            Node *prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // consumer thread only
+        bool pop(T &value)
+        {
+            Node *next = m_tail->next.load(std::memory_order_acquire);
+            if (!next)
+            {
+                return false;
+            }
+
+            // next becomes the new stub, its value is moved out
+            value = std::move(next->value);
+            release(m_tail);
+            m_tail = next;
+            return true;
+        }
+
+    private:
+        // any thread, a pooled node if one is free
+        Node *acquire()
+        {
+            uint64_t top = m_free.load(std::memory_order_acquire);
+            while ((uint32_t)top != NO_NODE)
+            {
+                Node &node = m_pool[(uint32_t)top];
+                const uint64_t next = ((top >> 32) + 1) << 32 | node.free_next.load(std::memory_order_relaxed);
+                if (m_free.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    node.next.store(nullptr, std::memory_order_relaxed);
+                    return &node;
+                }
+            }
+            return new Node();
+        }
+
+        // consumer thread only (and the constructor)
+        void release(Node *node)
+        {
+            if (node->slot == NO_NODE)
+            {
+                delete node;
+                return;
+            }
+
+            uint64_t top = m_free.load(std::memory_order_relaxed);
+            do
+            {
+                node->free_next.store((uint32_t)top, std::memory_order_relaxed);
+            } while (!m_free.compare_exchange_weak(top, (top >> 32) << 32 | node->slot, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+        }
+    };
+}
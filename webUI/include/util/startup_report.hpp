@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdio>
+
+namespace WUI
+{
+    // Milestones of one app start, for tracking time to first frame. Every phase is stamped once, the first
+    // mark wins, later ones cost a relaxed load. Times are relative to main() (Startup::begin).
+    namespace Startup
+    {
+        enum Phase
+        {
+            MainEntered,      // main(), the process itself was spawned before (see processStartMs)
+            SubprocessCheck,  // CefExecuteProcess returned, this is the browser process
+            DisplayStarted,   // display and renderer setup began, overlapped with CefInitialize
+            CefInitialized,   // CefInitialize returned
+            DisplayCreated,   // display, OSR bitmap, queues and the simulation are up
+            DisplayReady,     // the main thread has the display and can render
+            BrowserRequested, // CreateBrowser called, returns before the browser exists
+            BrowserCreated,   // OnAfterCreated
+            FirstFrame,       // first flip, game content only
+            FirstPaint,       // first OnPaint from CEF
+            LoadEnd,          // main frame finished loading
+            FirstUiFrame,     // first flip that shows the page
+            PHASES,
+        };
+
+        // at the top of main()
+        void begin();
+
+        // any thread
+        void mark(Phase phase);
+
+        // ms since main(), negative if the phase was not reached
+        double at(Phase phase);
+
+        // ms from process creation to main(), negative where the OS does not tell (Linux only)
+        double processStartMs();
+
+        // phase table plus the time to first frame and to first UI frame
+        void report(FILE *out);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util/aligned_vector.hpp"
+
+namespace WUI
+{
+    // Work stealing pool for data parallel loops.
+    // parallelFor cuts [0, count) into chunks of `grain`, hands every thread a contiguous run of them and lets
+    // threads that run out steal single chunks from the back of another's run. Chunk boundaries depend only on
+    // count and grain, never on the thread count or on who ran what, so a loop that writes only its own range
+    // gives the same result on any number of threads.
+    // One loop runs at a time, a parallelFor issued while another is in flight (other thread or nested) runs
+    // inline on its caller.
+    class TaskScheduler
+    {
+    private:
+        typedef void (*RangeFn)(void *context, size_t begin, size_t end);
+
+        // chunk indices [begin, end) packed as end << 32 | begin, so claiming one is a single CAS.
+        // One cache line each, owners and thieves hammer them.
+        struct alignas(CACHE_LINE) Run
+        {
+            std::atomic<uint64_t> range{0};
+        };
+
+        std::unique_ptr<Run[]> m_runs;
+        unsigned m_thread_count;
+        std::vector<std::thread> m_workers;
+
+        // the loop in flight, written before the runs are published and read only after a chunk was claimed
+        RangeFn m_fn = nullptr;
+        void *m_context = nullptr;
+        size_t m_count = 0;
+        size_t m_grain = 1;
+        alignas(CACHE_LINE) std::atomic<size_t> m_pending{0}; // chunks not finished yet
+
+        std::atomic<bool> m_busy{false}; // a loop is in flight
+        std::mutex m_wake_lock;
+        std::condition_variable m_wake;
+        uint64_t m_generation = 0; // guarded by m_wake_lock, bumped per loop
+        bool m_stop = false;
+
+    public:
+        // `threads` counts the calling thread, 0 = one per core
+        explicit TaskScheduler(unsigned threads = 0);
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler &) = delete;
+        TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+        // shared pool, sized to the machine
+        static TaskScheduler &instance();
+
+        unsigned getThreadCount() const
+        {
+            return m_thread_count;
+        }
+
+        // Calls fn(begin, end) over [0, count) in chunks of `grain` (the last one may be shorter) and returns
+        // once all of them ran. The caller works along. Chunks have to be independent of each other.
+        template <typename Fn>
+        void parallelFor(size_t count, size_t grain, Fn &&fn)
+        {
+            run(
+                count, grain, [](void *context, size_t begin, size_t end)
+                { (*static_cast<Fn *>(context))(begin, end); },
+                &fn);
+        }
+
+        // grain in elements of T that keeps chunk boundaries of cache aligned arrays on cache lines
+        template <typename T>
+        static size_t alignedGrain(size_t grain)
+        {
+            const size_t line = CACHE_LINE / sizeof(T) ? CACHE_LINE / sizeof(T) : 1;
+            return (grain + line - 1) / line * line;
+        }
+
+    private:
+        void run(size_t count, size_t grain, RangeFn fn, void *context);
+        void workerLoop(unsigned index);
+        // claims and runs chunks until no run has any left
+        void work(unsigned index);
+        void runChunk(uint64_t chunk);
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// compile the spans out entirely, at runtime a disabled span costs one relaxed load
+#ifndef WUI_TRACING
+#define WUI_TRACING 1
+#endif
+
+namespace WUI
+{
+    // Frame stage spans exported as Chrome trace events (chrome://tracing, ui.perfetto.dev).
+    // Every thread records into its own lock free ring buffer, the oldest spans are overwritten when it is full.
+    namespace Trace
+    {
+        extern std::atomic<bool> g_enabled;
+
+        inline bool enabled()
+        {
+            return g_enabled.load(std::memory_order_relaxed);
+        }
+
+        // steady clock, nanoseconds
+        int64_t now();
+
+        void start();
+        void stop();
+
+        // shift exported timestamps so they line up with a clock reading `reference_now_us` right now,
+        // e.g. CefNowFromSystemTraceTime() so the spans land on the same timeline as CEF's own trace
+        void syncClock(int64_t reference_now_us);
+
+        // label for the calling thread in the exported trace, `name` has to outlive the thread
+        void setThreadName(const char *name);
+
+        // `name` has to outlive the trace, string literals only
+        void record(const char *name, int64_t start_ns, int64_t end_ns);
+
+        // Write everything recorded so far as trace event JSON. If `merge_with` names a Chrome trace file
+        // (CefEndTracing output) its events are written into the same file.
+        bool write(const std::string &path, const std::string &merge_with = "");
+
+        // records the lifetime of the enclosing scope
+        class Span
+        {
+        private:
+            const char *m_name;
+            int64_t m_start = 0;
+
+        public:
+            explicit Span(const char *name)
+                : m_name(name)
+            {
+                if (enabled())
+                {
+                    m_start = now();
+                }
+            }
+
+            ~Span()
+            {
+                if (m_start)
+                {
+                    record(m_name, m_start, now());
+                }
+            }
+
+            Span(const Span &) = delete;
+            Span &operator=(const Span &) = delete;
+        };
+    }
+}
+
+#define WUI_TRACE_CONCAT_(a, b) a##b
+#define WUI_TRACE_CONCAT(a, b) WUI_TRACE_CONCAT_(a, b)
+
+#if WUI_TRACING
+#define TRACE_SPAN(name) WUI::Trace::Span WUI_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SPAN(name)
+#endif
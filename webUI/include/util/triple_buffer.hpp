@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace WUI
+{
+    // Lock free single producer / single consumer triple buffer.
+    // The producer always has a private back slot to write into, the consumer a private front slot to read from.
+    // Publishing and taking are a single atomic exchange of the shared middle slot index, so neither side ever
+    // blocks and the consumer always gets the latest complete value.
+    template <typename T>
+    class TripleBuffer
+    {
+    private:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH = 0x4; // middle slot was published and not taken yet
+
+        T m_slots[3];
+
+        std::atomic<uint8_t> m_middle{1};
+        uint8_t m_back = 0;  // producer owned
+        uint8_t m_front = 2; // consumer owned
+
+    public:
+        // producer side
+
+        T &back()
+        {
+            return m_slots[m_back];
+        }
+
+        // Hand the back slot to the consumer. Returns true if the value it replaced was never taken,
+        // back() then holds that skipped value.
+        bool publish()
+        {
+            const uint8_t old = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+            m_back = old & INDEX_MASK;
+            return (old & FRESH) != 0;
+        }
+
+        // consumer side
+
+        // Swap in the latest published value, false if nothing new was published since the last take
+        bool take()
+        {
+            if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            {
+                return false;
+            }
+            const uint8_t old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = old & INDEX_MASK;
+            return true;
+        }
+
+        T &front()
+        {
+            return m_slots[m_front];
+        }
+    };
+}
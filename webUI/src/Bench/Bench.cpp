@@ -0,0 +1,149 @@
+#include "Bench/Bench.hpp"
+#include "Bench/Harness.hpp"
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace WUI
+{
+    namespace Bench
+    {
+        struct Section
+        {
+            const char *name;  // for --bench-only
+            const char *title; // printed above its output, nullptr if the section prints its own
+            bool (*run)(const Options &options);
+        };
+
+        // in the order they run
+        static const Section SECTIONS[] = {
+            {"kernels", "[kernels]", pixelKernels},
+            {"balls", "[ball physics]", ballPhysics},
+            {"broadphase", "[broadphase]", broadphase},
+            {"parallel", "[parallel update]", parallelUpdate},
+            {"input", "[input coalescing]", inputCoalescing},
+            {"bus", "[event bus]", eventBus},
+            {"data", "[shared data]", sharedData},
+            {"spawn", "[spawn]", spawn},
+            {"resources", "[resources]", resources},
+            {"startup", "[startup report]", startupReport},
+            {"resize", "[resize]", resize},
+            {"popup", "[popup]", popup},
+            {"upload", "[upload modes]", uploadModes},
+            {"pipeline", nullptr, pipeline},
+        };
+
+        // value of "--name=value" or nullptr
+        static const char *argValue(const char *arg, const char *name)
+        {
+            const size_t length = strlen(name);
+            if (strncmp(arg, name, length) == 0 && arg[length] == '=')
+            {
+                return arg + length + 1;
+            }
+            return nullptr;
+        }
+
+        bool requested(int argc, char *argv[])
+        {
+            for (int i = 1; i < argc; i++)
+            {
+                if (strcmp(argv[i], "--bench") == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static Options parseOptions(int argc, char *argv[])
+        {
+            Options options;
+            for (int i = 1; i < argc; i++)
+            {
+                const char *value;
+                if ((value = argValue(argv[i], "--bench-size")))
+                {
+                    sscanf(value, "%dx%d", &options.width, &options.height);
+                }
+                else if ((value = argValue(argv[i], "--bench-frames")))
+                {
+                    options.frames = atoi(value);
+                }
+                else if ((value = argValue(argv[i], "--bench-pattern")))
+                {
+                    options.pattern = value;
+                }
+                else if ((value = argValue(argv[i], "--bench-paints-per-frame")))
+                {
+                    options.paints_per_frame = atof(value);
+                }
+                else if ((value = argValue(argv[i], "--bench-balls")))
+                {
+                    options.balls = atoi(value);
+                }
+                else if ((value = argValue(argv[i], "--bench-only")))
+                {
+                    options.only = value;
+                }
+                else if ((value = argValue(argv[i], "--trace")))
+                {
+                    options.trace_path = value;
+                }
+            }
+            options.width = std::max(options.width, 320);
+            options.height = std::max(options.height, 240);
+            options.frames = std::max(options.frames, 1);
+            return options;
+        }
+
+        static bool selected(const Options &options, const char *name)
+        {
+            if (options.only.empty())
+            {
+                return true;
+            }
+
+            // whole names only, "ball" must not select "balls"
+            const std::string list = "," + options.only + ",";
+            return list.find("," + std::string(name) + ",") != std::string::npos;
+        }
+
+        int run(int argc, char *argv[])
+        {
+            const Options options = parseOptions(argc, argv);
+
+            if (!al_init() || !al_init_primitives_addon())
+            {
+                printf("failed to initialize allegro\n");
+                return 1;
+            }
+
+            printf("WUI bench %dx%d, pattern %s, %d frames, %.2f paints/frame, %d balls\n",
+                   options.width, options.height, options.pattern.c_str(), options.frames,
+                   options.paints_per_frame, options.balls);
+
+            bool ok = true;
+            for (const Section &section : SECTIONS)
+            {
+                if (!selected(options, section.name))
+                {
+                    continue;
+                }
+                if (section.title)
+                {
+                    printf("%s\n", section.title);
+                }
+                ok &= section.run(options);
+            }
+
+            return ok ? 0 : 1;
+        }
+    }
+}
@@ -0,0 +1,504 @@
+#include "Bench/Harness.hpp"
+
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "Objects/BallCollider.hpp"
+#include "Objects/BallPhysics.hpp"
+#include "Objects/BallSimulation.hpp"
+#include "Objects/BallStore.hpp"
+#include "Objects/CircleBatch.hpp"
+#include "Objects/UniformGrid.hpp"
+#include "util/task_scheduler.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        struct Bodies
+        {
+            std::vector<float> x, y, vx, vy;
+
+            explicit Bodies(size_t count, int width, int height, uint32_t seed)
+                : x(count), y(count), vx(count), vy(count)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    // some start outside the bounds, the kernels have to clamp those too
+                    seed = seed * 1664525u + 1013904223u;
+                    x[i] = (float)(seed % (uint32_t)(width + 40)) - 20;
+                    seed = seed * 1664525u + 1013904223u;
+                    y[i] = (float)(seed % (uint32_t)(height + 40)) - 20;
+                    seed = seed * 1664525u + 1013904223u;
+                    const float angle = 20 + seed % 20;
+                    const float speed = 200 + seed % 200;
+                    vx[i] = speed * std::cos(angle);
+                    vy[i] = speed * std::sin(angle);
+                }
+            }
+
+            bool operator==(const Bodies &other) const
+            {
+                return x == other.x && y == other.y && vx == other.vx && vy == other.vy;
+            }
+        };
+
+        // the SIMD kernels have to match the scalar one bit for bit, over tails of every length
+        static bool verifyBallKernels(const Options &options)
+        {
+            using namespace BallPhysics;
+
+            bool ok = true;
+            for (Isa isa : {Isa::SSSE3, Isa::AVX2})
+            {
+                const StepKernel kernel = stepKernel(isa);
+                if (!kernel || !isaSupported(isa))
+                {
+                    continue;
+                }
+
+                for (size_t count = 0; count < 40 && ok; count++)
+                {
+                    Bodies expected(count, options.width, options.height, (uint32_t)count);
+                    Bodies actual = expected;
+                    for (int step = 0; step < 300; step++)
+                    {
+                        stepKernel(Isa::Scalar)(expected.x.data(), expected.y.data(), expected.vx.data(), expected.vy.data(),
+                                                count, options.width, options.height, 1.0f / 60);
+                        kernel(actual.x.data(), actual.y.data(), actual.vx.data(), actual.vy.data(),
+                               count, options.width, options.height, 1.0f / 60);
+                    }
+                    if (!(expected == actual))
+                    {
+                        printf("  %s ball kernel MISMATCH at %zu balls\n", isaName(isa), count);
+                        ok = false;
+                    }
+                }
+            }
+            printf("  ball kernels %s against the scalar reference\n", ok ? "bit-exact" : "FAILED");
+            return ok;
+        }
+
+        // The velocity model has to follow the angle based one it replaced: speed * (cos, sin) every frame,
+        // angle = pi - angle on a vertical wall, -angle on a horizontal one. Both accumulate float rounding
+        // differently, so this compares within a tolerance and reports the drift.
+        static bool verifyBallModel(const Options &options)
+        {
+            const size_t count = 1000;
+            const int steps = 600;
+            const float dt = 1.0f / 60;
+            const float width = options.width;
+            const float height = options.height;
+
+            Bodies bodies(count, options.width, options.height, 1234);
+
+            // previous model, straight from the old Ball::render
+            std::vector<float> x = bodies.x, y = bodies.y, speed(count), angle(count);
+            uint32_t seed = 1234;
+            for (size_t i = 0; i < count; i++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                seed = seed * 1664525u + 1013904223u;
+                seed = seed * 1664525u + 1013904223u;
+                angle[i] = 20 + seed % 20;
+                speed[i] = 200 + seed % 200;
+            }
+
+            double max_drift = 0;
+            for (int step = 0; step < steps; step++)
+            {
+                BallPhysics::step(bodies.x.data(), bodies.y.data(), bodies.vx.data(), bodies.vy.data(), count, width, height, dt);
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    x[i] += speed[i] * dt * cos(angle[i]);
+                    y[i] += speed[i] * dt * sin(angle[i]);
+
+                    if (x[i] < 0)
+                    {
+                        x[i] = 0;
+                        angle[i] = M_PI - angle[i];
+                    }
+                    else if (x[i] > width)
+                    {
+                        x[i] = width;
+                        angle[i] = M_PI - angle[i];
+                    }
+
+                    if (y[i] < 0)
+                    {
+                        y[i] = 0;
+                        angle[i] = -angle[i];
+                    }
+                    else if (y[i] > height)
+                    {
+                        y[i] = height;
+                        angle[i] = -angle[i];
+                    }
+
+                    max_drift = std::max(max_drift, (double)std::hypot(x[i] - bodies.x[i], y[i] - bodies.y[i]));
+                }
+            }
+
+            // rounding can put a bounce one frame earlier or later, that is at most one frame of travel at top speed
+            const bool ok = max_drift <= 400 * dt;
+            printf("  velocity model vs angle model: max drift %.4f px over %d frames (limit %.2f), %s\n",
+                   max_drift, steps, 400 * dt, ok ? "ok" : "FAILED");
+            return ok;
+        }
+
+        static void benchBallKernels(const Options &options)
+        {
+            using namespace BallPhysics;
+
+            printf("  %-10s", "balls/ms");
+            for (Isa isa : {Isa::Scalar, Isa::SSSE3, Isa::AVX2})
+            {
+                printf(" %10s", isaName(isa));
+            }
+            printf("\n");
+
+            for (size_t count : {1000, 10000, 100000, 1000000})
+            {
+                printf("  %-10zu", count);
+                for (Isa isa : {Isa::Scalar, Isa::SSSE3, Isa::AVX2})
+                {
+                    const StepKernel kernel = stepKernel(isa);
+                    if (!kernel || !isaSupported(isa))
+                    {
+                        printf(" %10s", "-");
+                        continue;
+                    }
+
+                    Bodies bodies(count, options.width, options.height, 42);
+                    const Timed timed = timeFor(0.2, [&]()
+                                                { kernel(bodies.x.data(), bodies.y.data(), bodies.vx.data(), bodies.vy.data(),
+                                                         count, options.width, options.height, 1.0f / 60); });
+
+                    printf(" %10.0f", timed.rate((double)count) / 1000);
+                }
+                printf("\n");
+            }
+            printf("  dispatch picks %s\n", isaName(activeIsa()));
+        }
+
+        // per circle draw calls against the batch, into a memory bitmap like the headless pipeline
+        static void benchBallDraw(const Options &options)
+        {
+            const int old_flags = al_get_new_bitmap_flags();
+            al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+            ALLEGRO_BITMAP *target = al_create_bitmap(options.width, options.height);
+            al_set_new_bitmap_flags(old_flags);
+            if (!target)
+            {
+                printf("  failed to create target bitmap\n");
+                return;
+            }
+
+            ALLEGRO_BITMAP *old_target = al_get_target_bitmap();
+            al_set_target_bitmap(target);
+
+            printf("  %-10s %14s %14s %14s\n", "balls", "per call [ms]", "batched [ms]", "vertices/ms");
+            for (size_t count : {100, 1000, 10000})
+            {
+                BallStore balls;
+                balls.reserve(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    balls.spawn(rand() % options.width, rand() % options.height);
+                }
+
+                const int frames = 10;
+
+                const Timed per_call = timeRuns(frames, [&]()
+                                                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        al_draw_filled_circle(balls.x()[i], balls.y()[i], balls.radius()[i], balls.color()[i]);
+                    } });
+
+                Circles circles;
+                circles.x = balls.x();
+                circles.y = balls.y();
+                circles.radius = balls.radius();
+                circles.color = balls.color();
+                circles.count = balls.size();
+                circles.layout_version = balls.layoutVersion();
+
+                CircleBatch batch;
+                const Timed batched = timeRuns(frames, [&]()
+                                               { batch.draw(circles); });
+
+                printf("  %-10zu %14.3f %14.3f %14.0f\n", count, per_call.perRun() * 1000, batched.perRun() * 1000,
+                       batch.getVertexCount() / (batched.perRun() * 1000));
+            }
+
+            al_set_target_bitmap(old_target);
+            al_destroy_bitmap(target);
+        }
+
+        // Balls spread over a world that grows with the count, about a third of it covered like a busy view,
+        // so the numbers show how the broadphase scales and not how crowded the balls are.
+        static void spawnSpread(BallStore &balls, size_t count, float &world)
+        {
+            world = std::sqrt(count * (float)M_PI * 60 * 60 / 0.3f);
+            balls.reserve(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                balls.spawn(rand() / (float)RAND_MAX * world, rand() / (float)RAND_MAX * world);
+            }
+        }
+
+        // The grid has to find exactly the ball a brute force search finds, also after the collision pass moved
+        // the balls away from where the grid was built.
+        static bool verifyPick()
+        {
+            BallStore balls;
+            float world;
+            spawnSpread(balls, 2000, world);
+
+            const size_t count = balls.size();
+            std::vector<float> x(balls.x(), balls.x() + count), y(balls.y(), balls.y() + count);
+            std::vector<float> vx(count, 100), vy(count, -50);
+            const float *radius = balls.radius();
+
+            BallCollider collider;
+            collider.resolve(x.data(), y.data(), vx.data(), vy.data(), radius, count, world, world, 1, TaskScheduler::instance());
+
+            size_t mismatches = 0, hits = 0;
+            for (int query = 0; query < 10000; query++)
+            {
+                const float px = rand() / (float)RAND_MAX * world;
+                const float py = rand() / (float)RAND_MAX * world;
+
+                int64_t expected = -1;
+                for (size_t i = 0; i < count; i++)
+                {
+                    const float dx = px - x[i];
+                    const float dy = py - y[i];
+                    if (dx * dx + dy * dy <= radius[i] * radius[i])
+                    {
+                        expected = i;
+                    }
+                }
+
+                const int64_t picked = collider.pick(px, py, x.data(), y.data(), radius, count, world, world, 1);
+                hits += picked >= 0;
+                mismatches += picked != expected;
+            }
+
+            printf("  pick vs brute force: %zu hits in 10000 queries, %zu mismatches, %s\n",
+                   hits, mismatches, mismatches ? "FAILED" : "ok");
+            return mismatches == 0;
+        }
+
+        static void benchBroadphase()
+        {
+            printf("  %-10s %12s %12s %12s %12s\n", "balls", "grid [ms]", "tick [ms]", "pick [us]", "cells");
+            for (size_t count : {1000, 10000, 100000})
+            {
+                BallStore balls;
+                float world;
+                spawnSpread(balls, count, world);
+
+                // a few ticks first so the balls settle out of their random overlaps
+                for (int tick = 0; tick < 10; tick++)
+                {
+                    balls.update(world, world, 1.0f / 120);
+                }
+
+                // the grid on its own
+                UniformGrid grid;
+                const Timed build = timeFor(0.2, [&]()
+                                            { grid.build(balls.x(), balls.y(), count, 2 * 110, world, world); });
+
+                // integration, grid and collision response, what the simulation pays per tick
+                const Timed tick = timeFor(0.2, [&]()
+                                           { balls.update(world, world, 1.0f / 120); });
+
+                size_t found = 0;
+                const Timed pick = timeRuns(100000, [&]()
+                                            { found += balls.pick(rand() / (float)RAND_MAX * world,
+                                                                  rand() / (float)RAND_MAX * world)
+                                                           .valid(); });
+
+                printf("  %-10zu %12.3f %12.3f %12.3f %12zu\n", count, build.perRun() * 1000, tick.perRun() * 1000,
+                       pick.perRun() * 1e6, grid.getCellCount());
+                (void)found;
+            }
+        }
+
+        // Ball ticks on 1 to N threads. Every count has to produce bit identical balls, the chunks are the same
+        // whoever runs them.
+        static bool benchParallelTick()
+        {
+            const size_t count = 100000;
+            const int ticks = 30;
+            const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+            std::vector<unsigned> thread_counts;
+            for (unsigned threads = 1; threads < cores; threads *= 2)
+            {
+                thread_counts.push_back(threads);
+            }
+            thread_counts.push_back(cores);
+            // oversubscribed on small machines, still proves the result does not depend on the split
+            if (cores < 4)
+            {
+                thread_counts.push_back(4);
+            }
+
+            srand(99);
+            BallStore initial;
+            float world;
+            spawnSpread(initial, count, world);
+
+            std::vector<float> reference_x, reference_y;
+            double single = 0;
+            bool identical = true;
+
+            printf("  %zu balls, %d ticks, %u cores\n", count, ticks, cores);
+            printf("  %-10s %12s %10s %12s\n", "threads", "tick [ms]", "speedup", "result");
+            for (unsigned threads : thread_counts)
+            {
+                TaskScheduler scheduler(threads);
+                BallStore balls = initial;
+
+                const Timed timed = timeRuns(ticks, [&]()
+                                             { balls.update(world, world, 1.0f / 120, scheduler); });
+                const double seconds = timed.perRun();
+
+                bool same = true;
+                if (reference_x.empty())
+                {
+                    reference_x.assign(balls.x(), balls.x() + count);
+                    reference_y.assign(balls.y(), balls.y() + count);
+                    single = seconds;
+                }
+                else
+                {
+                    same = memcmp(reference_x.data(), balls.x(), count * sizeof(float)) == 0 &&
+                           memcmp(reference_y.data(), balls.y(), count * sizeof(float)) == 0;
+                    identical &= same;
+                }
+
+                printf("  %-10u %12.3f %9.2fx %12s\n", threads, seconds * 1000, single / seconds,
+                       same ? "identical" : "DIFFERENT");
+            }
+            return identical;
+        }
+
+        // producer side cost of spawning through the command queue, and how long the simulation takes to apply it
+        static void benchSpawn(const Options &options)
+        {
+            const size_t count = 100000;
+
+            for (bool bulk : {false, true})
+            {
+                FrameScheduler scheduler;
+                BallSimulation simulation(scheduler, options.width, options.height);
+
+                std::vector<vec2f> positions(count, vec2f(options.width / 2, options.height / 2));
+
+                // queued before the thread runs, so the first tick applies all of it
+                auto start = Clock::now();
+                if (bulk)
+                {
+                    simulation.spawn(std::move(positions));
+                }
+                else
+                {
+                    for (const auto &position : positions)
+                    {
+                        simulation.spawn(position.x, position.y);
+                    }
+                }
+                const double queued = secondsSince(start);
+
+                start = Clock::now();
+                simulation.start();
+                const BallSnapshot *snapshot = nullptr;
+                while (!(snapshot = simulation.latest()) || snapshot->size() < count)
+                {
+                    std::this_thread::yield();
+                }
+                const double applied = secondsSince(start);
+                simulation.stop();
+
+                printf("  %zu %-6s queued in %8.3f ms (%6.1f ns each), visible after %8.3f ms\n",
+                       count, bulk ? "bulk" : "single", queued * 1000, queued * 1e9 / count, applied * 1000);
+            }
+        }
+
+        // A pick queued while the simulation thread runs, with stop() racing it: either the thread's next tick or
+        // stop() answers it. A broken promise would throw from get().
+        static bool verifyPickOnStop(const Options &options)
+        {
+            const int rounds = 200;
+            int answered = 0;
+            for (int round = 0; round < rounds; round++)
+            {
+                FrameScheduler scheduler;
+                BallSimulation simulation(scheduler, options.width, options.height);
+                simulation.spawn(options.width / 2, options.height / 2);
+                simulation.start();
+
+                // half the rounds give the thread part of a tick to get into it first
+                if (round % 2)
+                {
+                    std::this_thread::sleep_for(std::chrono::duration<double>(BallSimulation::TICK_SECONDS * (round % 4) / 4));
+                }
+                std::future<BallHandle> picked = simulation.pick(options.width / 2, options.height / 2);
+                simulation.stop();
+
+                if (picked.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    picked.get();
+                    answered++;
+                }
+            }
+
+            const bool ok = answered == rounds;
+            printf("  %d picks racing stop %s\n", rounds, ok ? "answered: ok" : "NOT ANSWERED: FAILED");
+            return ok;
+        }
+
+        bool ballPhysics(const Options &options)
+        {
+            bool ok = verifyBallKernels(options);
+            ok &= verifyBallModel(options);
+            benchBallKernels(options);
+            benchBallDraw(options);
+            return ok;
+        }
+
+        bool broadphase(const Options &)
+        {
+            const bool ok = verifyPick();
+            benchBroadphase();
+            return ok;
+        }
+
+        bool parallelUpdate(const Options &)
+        {
+            return benchParallelTick();
+        }
+
+        bool spawn(const Options &options)
+        {
+            const bool ok = verifyPickOnStop(options);
+            benchSpawn(options);
+            return ok;
+        }
+    }
+}
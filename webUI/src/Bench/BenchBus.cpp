@@ -0,0 +1,165 @@
+#include "Bench/Harness.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Bench/DataChannelBench.hpp"
+#include "Bus/BusCodec.hpp"
+#include "Bus/SharedData.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        // Encodes a mix of every value type and decodes it again, then the cost of a frame's worth of events
+        // in one batch against one message per event. Only the codec is measured, the IPC itself needs CEF.
+        static bool benchEventBus()
+        {
+            const size_t count = 100000;
+
+            auto valueFor = [](size_t i)
+            {
+                switch (i % 4)
+                {
+                case 0:
+                    return Bus::Value();
+                case 1:
+                    return Bus::Value::boolean(i & 8);
+                case 2:
+                    return Bus::Value::of(i * 0.5);
+                default:
+                    return Bus::Value::of("ball " + std::to_string(i));
+                }
+            };
+
+            Bus::BatchWriter writer;
+            for (size_t i = 0; i < count; i++)
+            {
+                writer.add(i % 2 ? "engine.balls" : "ui.increment", valueFor(i), i % 3 == 0 ? Bus::FLAG_STATE : 0);
+            }
+
+            size_t decoded = 0, mismatches = 0;
+            const bool decoded_ok = Bus::decode(writer.bytes().data(), writer.bytes().size(),
+                                                [&](const std::string &topic, const Bus::Value &value, uint8_t flags)
+                                                {
+                                                    const Bus::Value expected = valueFor(decoded);
+                                                    mismatches += topic != (decoded % 2 ? "engine.balls" : "ui.increment") ||
+                                                                  value.type != expected.type || value.number != expected.number ||
+                                                                  value.string != expected.string ||
+                                                                  flags != (decoded % 3 == 0 ? Bus::FLAG_STATE : 0);
+                                                    decoded++;
+                                                });
+
+            // a truncated batch has to be refused, not read past its end
+            const bool truncated_refused = !Bus::decode(writer.bytes().data(), writer.bytes().size() - 3,
+                                                        [](const std::string &, const Bus::Value &, uint8_t) {});
+
+            const bool ok = decoded_ok && decoded == count && mismatches == 0 && truncated_refused;
+            printf("  round trip %zu events, %zu mismatches, truncated batch %s: %s\n", decoded, mismatches,
+                   truncated_refused ? "refused" : "ACCEPTED", ok ? "ok" : "FAILED");
+
+            // 10k events per second from the engine, flushed at 60 fps or sent one by one
+            const size_t per_second = 10000;
+            const int ui_fps = 60;
+            const int rounds = 20;
+            writer.clear();
+
+            for (bool batched : {true, false})
+            {
+                const size_t per_message = batched ? per_second / ui_fps : 1;
+                size_t messages = 0, bytes = 0, received = 0;
+
+                const Timed timed = timeRuns(rounds, [&]()
+                                             {
+                    for (size_t i = 0; i < per_second; i++)
+                    {
+                        writer.add("engine.balls", Bus::Value::of((double)i));
+                        if (writer.count() == per_message || i + 1 == per_second)
+                        {
+                            Bus::decode(writer.bytes().data(), writer.bytes().size(),
+                                        [&](const std::string &, const Bus::Value &, uint8_t)
+                                        { received++; });
+                            bytes += writer.bytes().size();
+                            messages++;
+                            writer.clear();
+                        }
+                    } });
+
+                printf("  %-8s %6zu messages/s, %6.1f bytes/event, encode+decode %7.1f ns/event (%zu events)\n",
+                       batched ? "batched" : "single", messages / rounds, bytes / (double)received,
+                       timed.seconds * 1e9 / received, received);
+            }
+
+            return ok;
+        }
+
+        // Engine side cost of handing one float array to the page: writing a shared memory snapshot against
+        // building the ExecuteJavaScript source. The region is a plain buffer here, allocating it and the page side
+        // need CEF, webUI --data-bench measures the whole trip.
+        static bool benchSharedData()
+        {
+            const std::string name = "bench";
+
+            // the header has to survive the trip and a cut off region must not be read
+            std::vector<float> check(1000, 1.5f);
+            std::vector<uint8_t> region(Bus::dataRegionSize(name.size(), Bus::DataType::F32, check.size()));
+            Bus::writeDataHeader(region.data(), name, Bus::DataType::F32, 7, check.size());
+            memcpy(region.data() + Bus::dataOffset(name.size()), check.data(), check.size() * sizeof(float));
+
+            Bus::DataHeader header;
+            std::string read_name;
+            const bool read = Bus::readDataHeader(region.data(), region.size(), header, read_name) && read_name == name &&
+                              header.generation == 7 && header.count == check.size() && header.data_offset % Bus::DATA_ALIGNMENT == 0 &&
+                              memcmp(region.data() + header.data_offset, check.data(), check.size() * sizeof(float)) == 0;
+            const bool truncated_refused = !Bus::readDataHeader(region.data(), region.size() - 1, header, read_name);
+            const bool ok = read && truncated_refused;
+            printf("  snapshot header %s, truncated region %s: %s\n", read ? "read back" : "WRONG",
+                   truncated_refused ? "refused" : "ACCEPTED", ok ? "ok" : "FAILED");
+
+            printf("  %-10s %14s %12s %14s %12s %10s\n", "floats", "shared [ms]", "MB/s", "script [ms]", "MB/s", "script MB");
+            for (size_t count : {4096, 65536, 262144, 1048576})
+            {
+                std::vector<float> data(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    data[i] = std::sin((float)i) * 1000;
+                }
+                const double megabytes = count * sizeof(float) / 1e6;
+                const int repeats = (int)std::max<size_t>(4, (1 << 22) / count);
+
+                region.resize(Bus::dataRegionSize(name.size(), Bus::DataType::F32, count));
+                uint64_t generation = 0;
+                const Timed written = timeRuns(repeats, [&]()
+                                               {
+                    Bus::writeDataHeader(region.data(), name, Bus::DataType::F32, ++generation, count);
+                    memcpy(region.data() + Bus::dataOffset(name.size()), data.data(), count * sizeof(float)); });
+                const double shared = written.perRun();
+
+                size_t script_bytes = 0;
+                generation = 0;
+                const Timed encoded = timeRuns(repeats, [&]()
+                                               { script_bytes = DataChannelBench::encodeScript(++generation, data.data(), count).size(); });
+                const double script = encoded.perRun();
+
+                printf("  %-10zu %14.3f %12.1f %14.3f %12.1f %10.2f\n", count, shared * 1000, megabytes / shared,
+                       script * 1000, megabytes / script, script_bytes / 1e6);
+            }
+
+            return ok;
+        }
+
+        bool eventBus(const Options &)
+        {
+            return benchEventBus();
+        }
+
+        bool sharedData(const Options &)
+        {
+            return benchSharedData();
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#include "Bench/Harness.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Input/InputCoalescer.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        // A 1000 Hz mouse sweeping for two seconds with a wheel tick every 10 ms, replayed against the coalescer
+        // the way the input loop drives it. Counts what would have been posted into CEF with and without it.
+        static void benchInputCoalescing()
+        {
+            const double seconds = 2;
+            const double poll = 1.0 / 1000;
+            const int ui_fps = 60;
+
+            InputCoalescer coalescer(1.0 / ui_fps);
+            size_t moves = 0, wheels = 0, move_posts = 0, wheel_posts = 0;
+            double first_unsent = -1, worst_delay = 0; // oldest move not posted yet
+
+            auto flush = [&](double now)
+            {
+                const InputCoalescer::Pending pending = coalescer.take(now);
+                if (pending.move)
+                {
+                    move_posts++;
+                    worst_delay = std::max(worst_delay, now - first_unsent);
+                    first_unsent = -1;
+                }
+                wheel_posts += pending.wheel_z || pending.wheel_w;
+            };
+
+            for (int i = 0; i * poll < seconds; i++)
+            {
+                const double now = i * poll;
+
+                // the loop wakes on its own when a deadline passes between two events
+                if (coalescer.hasPending() && coalescer.deadline() <= now)
+                {
+                    flush(coalescer.deadline());
+                }
+
+                coalescer.move(i % 1920, i % 1080);
+                first_unsent = first_unsent < 0 ? now : first_unsent;
+                moves++;
+                if (i % 10 == 0)
+                {
+                    coalescer.wheel(1, 0);
+                    wheels++;
+                }
+
+                if (coalescer.due(now))
+                {
+                    flush(now);
+                }
+            }
+
+            printf("  %d Hz mouse, %d fps ui, %.0f s: %zu moves -> %zu posts (%.1fx fewer), %zu wheel ticks -> %zu posts\n",
+                   (int)(1 / poll), ui_fps, seconds, moves, move_posts, moves / (double)std::max<size_t>(move_posts, 1),
+                   wheels, wheel_posts);
+            printf("  a move waited at most %.2f ms to be posted\n", worst_delay * 1000);
+        }
+
+        bool inputCoalescing(const Options &)
+        {
+            benchInputCoalescing();
+            return true;
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#include "Bench/Harness.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Render/PixelConvert.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        // every kernel has to match the scalar reference bit for bit, including odd row lengths and strides
+        static bool verifyKernels()
+        {
+            using namespace PixelConvert;
+
+            const RowKernel reference = rowKernel(Isa::Scalar);
+            bool ok = true;
+
+            for (Isa isa : {Isa::SSSE3, Isa::AVX2})
+            {
+                const RowKernel kernel = rowKernel(isa);
+                if (!kernel || !isaSupported(isa))
+                {
+                    continue;
+                }
+
+                for (size_t pixels = 0; pixels < 300; pixels++)
+                {
+                    // offset by one byte so nothing is accidentally aligned
+                    std::vector<uint8_t> src(pixels * 4 + 1);
+                    std::vector<uint8_t> expected(pixels * 4 + 1), actual(pixels * 4 + 1);
+                    for (size_t i = 0; i < src.size(); i++)
+                    {
+                        src[i] = (uint8_t)(i * 131 + pixels * 7);
+                    }
+
+                    reference(expected.data() + 1, src.data() + 1, pixels);
+                    kernel(actual.data() + 1, src.data() + 1, pixels);
+
+                    if (memcmp(expected.data(), actual.data(), expected.size()) != 0)
+                    {
+                        printf("  %s kernel MISMATCH at %zu pixels\n", isaName(isa), pixels);
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+
+            printf("  kernels %s against the scalar reference\n", ok ? "bit-exact" : "FAILED");
+            return ok;
+        }
+
+        // bgraToRgba over sub rects: padded, contiguous and bottom up pitches have to give the scalar result row by
+        // row and leave the bytes between rows alone
+        static bool verifyBlocks()
+        {
+            using namespace PixelConvert;
+
+            const RowKernel reference = rowKernel(Isa::Scalar);
+            const uint8_t untouched = 0xcd;
+            bool ok = true;
+
+            for (int width : {1, 7, 33, 257})
+            {
+                for (int padding : {0, 4, 12})
+                {
+                    const int height = 5;
+                    const ptrdiff_t src_pitch = (ptrdiff_t)width * 4 + padding;
+                    std::vector<uint8_t> src((size_t)src_pitch * height);
+                    for (size_t i = 0; i < src.size(); i++)
+                    {
+                        src[i] = (uint8_t)(i * 37 + width);
+                    }
+
+                    for (bool bottom_up : {false, true})
+                    {
+                        const ptrdiff_t dst_pitch = ((ptrdiff_t)width * 4 + padding) * (bottom_up ? -1 : 1);
+                        const size_t dst_size = (size_t)(dst_pitch < 0 ? -dst_pitch : dst_pitch) * height;
+                        std::vector<uint8_t> expected(dst_size, untouched), actual(dst_size, untouched);
+                        const size_t first_row = bottom_up ? dst_size + dst_pitch : 0;
+
+                        for (int row = 0; row < height; row++)
+                        {
+                            reference(expected.data() + first_row + row * dst_pitch, src.data() + row * src_pitch, width);
+                        }
+                        bgraToRgba(actual.data() + first_row, dst_pitch, src.data(), src_pitch, width, height);
+
+                        if (expected != actual)
+                        {
+                            printf("  block MISMATCH at width %d, padding %d%s\n", width, padding, bottom_up ? ", bottom up" : "");
+                            ok = false;
+                        }
+                    }
+                }
+            }
+
+            printf("  %s blocks %s against the scalar reference\n", isaName(activeIsa()), ok ? "bit-exact" : "FAILED");
+            return ok;
+        }
+
+        // GB/s of destination bytes for converting (or copying) a full frame
+        static double blockThroughput(PixelConvert::BlockFn fn, int width, int height)
+        {
+            const ptrdiff_t pitch = (ptrdiff_t)width * 4;
+            std::vector<uint8_t> src((size_t)pitch * height, 0x5a), dst((size_t)pitch * height);
+
+            fn(dst.data(), pitch, src.data(), pitch, width, height); // fault the pages in
+
+            const Timed timed = timeFor(0.25, [&]()
+                                        { fn(dst.data(), pitch, src.data(), pitch, width, height); });
+            return timed.rate((double)dst.size()) / 1e9;
+        }
+
+        static double rowThroughput(PixelConvert::RowKernel kernel, int width, int height)
+        {
+            const size_t pitch = (size_t)width * 4;
+            std::vector<uint8_t> src(pitch * height, 0x5a), dst(pitch * height);
+
+            const Timed timed = timeFor(0.25, [&]()
+                                        {
+                for (int row = 0; row < height; row++)
+                {
+                    kernel(dst.data() + row * pitch, src.data() + row * pitch, width);
+                } });
+            return timed.rate((double)dst.size()) / 1e9;
+        }
+
+        static void benchKernels()
+        {
+            using namespace PixelConvert;
+
+            const int sizes[][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+
+            printf("  %-10s", "GB/s");
+            for (Isa isa : {Isa::Scalar, Isa::SSSE3, Isa::AVX2})
+            {
+                printf(" %8s", isaName(isa));
+            }
+            printf(" %8s\n", "copy");
+
+            for (const auto &size : sizes)
+            {
+                char label[32];
+                snprintf(label, sizeof(label), "%dx%d", size[0], size[1]);
+                printf("  %-10s", label);
+
+                for (Isa isa : {Isa::Scalar, Isa::SSSE3, Isa::AVX2})
+                {
+                    const RowKernel kernel = rowKernel(isa);
+                    if (kernel && isaSupported(isa))
+                    {
+                        printf(" %8.2f", rowThroughput(kernel, size[0], size[1]));
+                    }
+                    else
+                    {
+                        printf(" %8s", "-");
+                    }
+                }
+                printf(" %8.2f\n", blockThroughput(copy, size[0], size[1]));
+            }
+            printf("  dispatch picks %s\n", isaName(activeIsa()));
+        }
+
+        bool pixelKernels(const Options &)
+        {
+            bool ok = verifyKernels();
+            ok &= verifyBlocks();
+            benchKernels();
+            return ok;
+        }
+    }
+}
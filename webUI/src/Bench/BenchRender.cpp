@@ -0,0 +1,384 @@
+#include "Bench/Harness.hpp"
+#include "Bench/Samples.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "util/trace.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        // dirty rects CEF would report for paint number `index`
+        static std::vector<CefRect> damagePattern(const Options &options, uint64_t index)
+        {
+            const int w = options.width;
+            const int h = options.height;
+
+            if (options.pattern == "full")
+            {
+                return {CefRect(0, 0, w, h)};
+            }
+            if (options.pattern == "counter")
+            {
+                // a text input updating its value, like #auto in index.html
+                return {CefRect(w / 4, h / 4, 160, 24)};
+            }
+            if (options.pattern == "scatter")
+            {
+                // several small independent widgets
+                std::vector<CefRect> rects;
+                uint32_t seed = (uint32_t)index * 2654435761u;
+                for (int i = 0; i < 8; i++)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    const int x = (int)(seed % (uint32_t)(w - 64));
+                    seed = seed * 1664525u + 1013904223u;
+                    const int y = (int)(seed % (uint32_t)(h - 64));
+                    rects.push_back(CefRect(x, y, 64, 64));
+                }
+                return rects;
+            }
+
+            // blinking caret
+            return {CefRect(w / 4, h / 4, 2, 18)};
+        }
+
+        static void fillRect(std::vector<uint32_t> &buffer, int width, const CefRect &rect, uint32_t color)
+        {
+            for (int y = rect.y; y < rect.y + rect.height; y++)
+            {
+                std::fill_n(buffer.begin() + (size_t)y * width + rect.x, rect.width, color);
+            }
+        }
+
+        static void printStage(const char *name, const Samples &samples)
+        {
+            printf("  %-12s %9.3f %9.3f %9.3f\n", name,
+                   samples.percentile(0.5) * 1000, samples.percentile(0.99) * 1000, samples.percentile(0.999) * 1000);
+        }
+
+        // A window dragged to twice its size and back, CEF painting each size one frame late every other frame.
+        // Returns the peak of the UI buffer memory, `frame` gets the frame times and `stale` the late paints.
+        static size_t dragResize(const Options &options, bool pooled, ResizeStats &stats, Samples &frame, uint64_t &stale)
+        {
+            const int steps = 160;
+            const int max_width = options.width * 2;
+            const int max_height = options.height * 2;
+
+            RenderSettings settings;
+            settings.pooled_resize = pooled;
+            CefRefPtr<RenderHandler> handler = headlessHandler(options.width, options.height, settings);
+
+            // big enough for any size on the way, rows are tightly packed for whatever size is painted
+            std::vector<uint32_t> view((size_t)max_width * max_height, 0xff202020);
+
+            size_t peak_bytes = 0;
+            stale = 0;
+            int width = options.width;
+            int height = options.height;
+            for (int i = 0; i <= 2 * steps; i++)
+            {
+                const int step = i <= steps ? i : 2 * steps - i;
+                const int painted_width = width;
+                const int painted_height = height;
+                width = options.width + (max_width - options.width) * step / steps;
+                height = options.height + (max_height - options.height) * step / steps;
+
+                auto frame_start = Clock::now();
+                handler->resizeView(width, height);
+
+                // the odd frames CEF still paints the size it knew before
+                const bool late = i % 2 == 1 && (painted_width != width || painted_height != height);
+                const int paint_width = late ? painted_width : width;
+                const int paint_height = late ? painted_height : height;
+                stale += late;
+                const CefRenderHandler::RectList full = {CefRect(0, 0, paint_width, paint_height)};
+                handler->OnPaint(nullptr, PET_VIEW, full, view.data(), paint_width, paint_height);
+                handler->renderFrame(1.0 / BASE_FPS);
+                frame.add(secondsSince(frame_start));
+
+                stats = handler->getResizeStats();
+                peak_bytes = std::max(peak_bytes, stats.osr_bytes + stats.staging_bytes);
+            }
+
+            return peak_bytes;
+        }
+
+        bool resize(const Options &options)
+        {
+            printf("  %-8s %8s %8s %8s %8s %9s %9s %9s\n", "buffers", "resizes", "OSR", "staging", "stale", "peak MB",
+                   "p50 [ms]", "p99 [ms]");
+
+            bool ok = true;
+            for (bool pooled : {true, false})
+            {
+                ResizeStats stats;
+                Samples frame;
+                uint64_t stale = 0;
+                const size_t peak_bytes = dragResize(options, pooled, stats, frame, stale);
+
+                // every late paint has to be dropped, and nothing else
+                ok &= stats.stale_frames == stale;
+                printf("  %-8s %8llu %8llu %8llu %8llu %9.1f %9.3f %9.3f\n", pooled ? "pooled" : "exact",
+                       (unsigned long long)stats.resizes, (unsigned long long)stats.osr_reallocations,
+                       (unsigned long long)stats.staging_reallocations, (unsigned long long)stats.stale_frames,
+                       peak_bytes / 1e6, frame.percentile(0.5) * 1000, frame.percentile(0.99) * 1000);
+            }
+            printf("  stale frames %s\n", ok ? "dropped: ok" : "UPLOADED: FAILED");
+
+            // near the bitmap size limit the headroom is cut, the view itself never is
+            const int max_size = 4096;
+            ResizePolicy limited;
+            limited.setMaxSize(max_size);
+            bool clamped = true;
+            for (int size : {1000, 3400, 4000, max_size})
+            {
+                limited.fit(size, size / 2, 0);
+                clamped &= limited.capacityWidth() <= max_size && limited.capacityWidth() >= size && limited.capacityHeight() >= size / 2;
+            }
+            ok &= clamped;
+            printf("  headroom at a %d px bitmap limit %s\n", max_size, clamped ? "clamped: ok" : "EXCEEDED: FAILED");
+
+            return ok;
+        }
+
+        // a dropdown opened over a fully painted view, hovered and closed again: only popup pixels may be uploaded
+        bool popup(const Options &options)
+        {
+            CefRefPtr<RenderHandler> handler = headlessHandler(options.width, options.height);
+
+            std::vector<uint32_t> view((size_t)options.width * options.height, 0xff202020);
+            handler->OnPaint(nullptr, PET_VIEW, {CefRect(0, 0, options.width, options.height)}, view.data(), options.width, options.height);
+            handler->renderFrame(0);
+            const size_t view_bytes = handler->getLastFrameTimings().upload_bytes;
+
+            const CefRect popup(options.width / 4, options.height / 4, std::min(200, options.width / 2), std::min(240, options.height / 2));
+            const int row = std::max(1, std::min(20, popup.height));
+            std::vector<uint32_t> pixels((size_t)popup.width * popup.height, 0xffe0e0e0);
+
+            auto start = Clock::now();
+            handler->OnPopupSize(nullptr, popup);
+            handler->OnPopupShow(nullptr, true);
+            handler->OnPaint(nullptr, PET_POPUP, {CefRect(0, 0, popup.width, popup.height)}, pixels.data(), popup.width, popup.height);
+            handler->renderFrame(0);
+            const double open = secondsSince(start);
+            const size_t open_bytes = handler->getLastFrameTimings().upload_bytes;
+
+            // a paint also carries the damage of the one before it, the second hover shows what one costs
+            size_t hover_bytes = 0;
+            double hover = 0;
+            for (int i = 0; i < 2; i++)
+            {
+                start = Clock::now();
+                handler->OnPaint(nullptr, PET_POPUP, {CefRect(0, 0, popup.width, row)}, pixels.data(), popup.width, popup.height);
+                handler->renderFrame(0);
+                hover = secondsSince(start);
+                hover_bytes = handler->getLastFrameTimings().upload_bytes;
+            }
+
+            handler->OnPopupShow(nullptr, false);
+            handler->renderFrame(0);
+            const size_t close_bytes = handler->getLastFrameTimings().upload_bytes;
+
+            bool ok = open_bytes == (size_t)popup.width * popup.height * 4 && hover_bytes == (size_t)popup.width * row * 4 &&
+                      close_bytes == 0;
+            printf("  view %.3f MB, popup %dx%d open %.3f MB in %.3f ms, hover %.3f MB in %.3f ms, close %.3f MB: %s\n",
+                   view_bytes / 1e6, popup.width, popup.height, open_bytes / 1e6, open * 1000, hover_bytes / 1e6, hover * 1000,
+                   close_bytes / 1e6, ok ? "ok" : "FAILED");
+
+            // a paint the pacer never picked up before the popup closed must not be shown by the next one,
+            // that one's first paint has to arrive whole
+            handler->OnPopupShow(nullptr, true);
+            handler->OnPaint(nullptr, PET_POPUP, {CefRect(0, 0, popup.width, row)}, pixels.data(), popup.width, popup.height);
+            handler->OnPopupShow(nullptr, false);
+            handler->OnPopupShow(nullptr, true);
+            handler->renderFrame(0);
+            const size_t stale_bytes = handler->getLastFrameTimings().upload_bytes;
+
+            handler->OnPaint(nullptr, PET_POPUP, {CefRect(0, 0, popup.width, row)}, pixels.data(), popup.width, popup.height);
+            handler->renderFrame(0);
+            const size_t reopen_bytes = handler->getLastFrameTimings().upload_bytes;
+
+            const bool stale_ok = stale_bytes == 0 && reopen_bytes == (size_t)popup.width * popup.height * 4;
+            printf("  reopened popup: stale paint %.3f MB, first paint %.3f MB: %s\n", stale_bytes / 1e6, reopen_bytes / 1e6,
+                   stale_ok ? "ok" : "FAILED");
+
+            return ok && stale_ok;
+        }
+
+        static void benchPipeline(const Options &options, bool native)
+        {
+            RenderSettings settings;
+            settings.native_osr_format = native;
+            CefRefPtr<RenderHandler> handler = headlessHandler(options.width, options.height, settings);
+
+            std::vector<vec2f> positions;
+            for (int i = 0; i < options.balls; i++)
+            {
+                positions.push_back(vec2f(rand() % options.width, rand() % options.height));
+            }
+            handler->spawnBalls(std::move(positions));
+
+            // what CEF would keep in its view buffer, BGRA
+            std::vector<uint32_t> view((size_t)options.width * options.height, 0xff202020);
+            const CefRenderHandler::RectList initial = {CefRect(0, 0, options.width, options.height)};
+            handler->OnPaint(nullptr, PET_VIEW, initial, view.data(), options.width, options.height);
+            handler->renderFrame(0);
+
+            Samples paint, upload, renderables, draw_ui, flip, frame;
+            for (Samples *samples : {&paint, &upload, &renderables, &draw_ui, &flip, &frame})
+            {
+                samples->reserve(options.frames);
+            }
+
+            double paint_budget = 0;
+            uint64_t paint_index = 0;
+            size_t painted_bytes = 0;
+            size_t uploaded_bytes = 0;
+
+            auto start = Clock::now();
+            for (int i = 0; i < options.frames; i++)
+            {
+                auto frame_start = Clock::now();
+
+                // CEF side, usually on its own thread, here interleaved with the frames at the configured rate
+                paint_budget += options.paints_per_frame;
+                while (paint_budget >= 1)
+                {
+                    paint_budget -= 1;
+                    paint_index++;
+
+                    const auto rects = damagePattern(options, paint_index);
+                    for (const auto &rect : rects)
+                    {
+                        fillRect(view, options.width, rect, 0xff000000 | (uint32_t)(paint_index * 0x10101));
+                        painted_bytes += (size_t)rect.width * rect.height * 4;
+                    }
+
+                    auto paint_start = Clock::now();
+                    handler->OnPaint(nullptr, PET_VIEW, rects, view.data(), options.width, options.height);
+                    paint.add(secondsSince(paint_start));
+                }
+
+                handler->renderFrame(1.0 / BASE_FPS);
+
+                const auto &timings = handler->getLastFrameTimings();
+                upload.add(timings.upload);
+                renderables.add(timings.renderables);
+                draw_ui.add(timings.draw_ui);
+                flip.add(timings.flip);
+                uploaded_bytes += timings.upload_bytes;
+
+                frame.add(secondsSince(frame_start));
+            }
+            const double elapsed = secondsSince(start);
+
+            printf("[pipeline: %s upload]\n", handler->getOsrUploadMode() == OsrUploadMode::Native ? "native" : "converting");
+            printf("  %.1f frames/s, paint %.1f MB/s, upload %.1f MB/s (%.3f MB per frame)\n",
+                   options.frames / elapsed,
+                   painted_bytes / elapsed / 1e6,
+                   uploaded_bytes / elapsed / 1e6,
+                   uploaded_bytes / (double)options.frames / 1e6);
+            printf("  %-12s %9s %9s %9s\n", "stage [ms]", "p50", "p99", "p999");
+            printStage("paint", paint);
+            printStage("upload", upload);
+            printStage("renderables", renderables);
+            printStage("draw_ui", draw_ui);
+            printStage("flip", flip);
+            printStage("frame", frame);
+        }
+
+        // Both upload modes have to put CEF's pixels on screen unchanged, the native row copy into ARGB_8888 as
+        // much as the swizzle into RGBA_8888. A full paint and a scattered partial one are read back from the
+        // headless target in a fixed byte order and compared with the painted BGRA.
+        bool uploadModes(const Options &options)
+        {
+            const int width = options.width;
+            const int height = options.height;
+
+            std::vector<uint32_t> view((size_t)width * height);
+            uint32_t seed = 7;
+            for (uint32_t &pixel : view)
+            {
+                // opaque, the blend onto the cleared target is then an exact copy
+                seed = seed * 1664525u + 1013904223u;
+                pixel = 0xff000000 | seed >> 8;
+            }
+
+            bool ok = true;
+            for (bool native : {true, false})
+            {
+                RenderSettings settings;
+                settings.native_osr_format = native;
+                CefRefPtr<RenderHandler> handler = headlessHandler(width, height, settings);
+
+                handler->OnPaint(nullptr, PET_VIEW, {CefRect(0, 0, width, height)}, view.data(), width, height);
+                handler->renderFrame(0);
+
+                Options scatter = options;
+                scatter.pattern = "scatter";
+                const std::vector<CefRect> rects = damagePattern(scatter, 1);
+                for (const auto &rect : rects)
+                {
+                    fillRect(view, width, rect, native ? 0xff3366cc : 0xffcc6633);
+                }
+                handler->OnPaint(nullptr, PET_VIEW, rects, view.data(), width, height);
+                handler->renderFrame(0);
+
+                // R G B A in memory, whatever format the target has
+                ALLEGRO_BITMAP *target = al_get_target_bitmap();
+                ALLEGRO_LOCKED_REGION *locked = al_lock_bitmap(target, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+                size_t mismatches = 0;
+                for (int y = 0; locked && y < height; y++)
+                {
+                    const uint8_t *row = (const uint8_t *)locked->data + (ptrdiff_t)y * locked->pitch;
+                    for (int x = 0; x < width; x++)
+                    {
+                        const uint32_t bgra = view[(size_t)y * width + x];
+                        const uint8_t expected[4] = {(uint8_t)(bgra >> 16), (uint8_t)(bgra >> 8), (uint8_t)bgra, (uint8_t)(bgra >> 24)};
+                        mismatches += memcmp(row + x * 4, expected, 4) != 0;
+                    }
+                }
+                if (locked)
+                {
+                    al_unlock_bitmap(target);
+                }
+
+                const bool mode_ok = locked && mismatches == 0;
+                ok &= mode_ok;
+                printf("  %-10s upload: %zu of %zu pixels differ, %s\n",
+                       handler->getOsrUploadMode() == OsrUploadMode::Native ? "native" : "converting", mismatches,
+                       (size_t)width * height, mode_ok ? "ok" : "FAILED");
+            }
+
+            return ok;
+        }
+
+        bool pipeline(const Options &options)
+        {
+            // both upload modes end up in the same file, one after the other
+            if (!options.trace_path.empty())
+            {
+                Trace::setThreadName("bench");
+                Trace::start();
+            }
+
+            benchPipeline(options, true);
+            benchPipeline(options, false);
+
+            if (!options.trace_path.empty())
+            {
+                Trace::stop();
+                if (!Trace::write(options.trace_path))
+                {
+                    printf("failed to write trace to %s\n", options.trace_path.c_str());
+                }
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "Bench/Harness.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Resources/ResourcePack.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        struct PackFile
+        {
+            std::string path;
+            std::string bytes;
+            bool gzip;
+        };
+
+        // the archive cmake/pack_resources.cmake writes
+        static std::string packBytes(const std::vector<PackFile> &files)
+        {
+            std::string index = "WUIPAK 1\n", data;
+            for (const auto &file : files)
+            {
+                index += std::to_string(data.size()) + " " + std::to_string(file.bytes.size()) + (file.gzip ? " gzip " : " identity ") +
+                         file.path + "\n";
+                data += file.bytes;
+            }
+            return index + "\n" + data;
+        }
+
+        static bool writeFile(const std::string &path, const std::string &bytes)
+        {
+            FILE *file = fopen(path.c_str(), "wb");
+            if (!file)
+            {
+                return false;
+            }
+            const bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+            return fclose(file) == 0 && written;
+        }
+
+        // every packed file is found with its bytes, type and encoding, nothing else is
+        static bool verifyLookups(const ResourcePack &pack, const std::vector<PackFile> &files)
+        {
+            bool ok = pack.count() == files.size();
+            for (const auto &file : files)
+            {
+                const PackedResource *resource = pack.find(file.path);
+                ok &= resource && resource->size == file.bytes.size() && memcmp(resource->data, file.bytes.data(), resource->size) == 0 &&
+                      resource->gzip == file.gzip && strcmp(resource->mime_type, ResourcePack::mimeType(file.path)) == 0;
+            }
+            for (const char *missing : {"", "css", "css/", "index", "index.html/", "/index.html", "missing.js"})
+            {
+                ok &= pack.find(missing) == nullptr;
+            }
+            return ok;
+        }
+
+        // written to `path`, then every shorter cut of it
+        static bool verifyPack(const char *name, const std::vector<PackFile> &files, const std::string &path)
+        {
+            const std::string bytes = packBytes(files);
+
+            ResourcePack pack;
+            const bool opened = writeFile(path, bytes) && pack.open(path);
+            const bool found = opened && verifyLookups(pack, files);
+            pack.close();
+
+            // the last file is not empty, so every cut either loses the end of the index or of the data
+            size_t accepted = 0;
+            for (size_t size = 0; size < bytes.size(); size++)
+            {
+                accepted += writeFile(path, bytes.substr(0, size)) && pack.open(path);
+                pack.close();
+            }
+
+            printf("  %s pack %zu files, %zu bytes: lookups %s, %zu truncations %s\n", name, files.size(), bytes.size(),
+                   found ? "ok" : "FAILED", bytes.size(), accepted ? "ACCEPTED" : "refused");
+            return opened && found && accepted == 0;
+        }
+
+        // Builds a plain and a gzip pack, looks paths up in both and has every truncation of them and a few foreign
+        // files refused. Only the archive is checked, serving it through app://ui needs CEF.
+        bool resources(const Options &)
+        {
+            const std::string gzip_magic("\x1f\x8b\x08\x00", 4);
+            const std::string html = "<!DOCTYPE html><html><body>wui</body></html>\n";
+            const std::string css = "body { margin: 0; }\n";
+            const std::string png("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16);
+
+            const std::vector<PackFile> plain = {
+                {"index.html", html, false},
+                {"css/main.css", css, false},
+                {"img/ball sprite.png", png, false},
+                {"empty.txt", "", false},
+                {"fonts/ui.woff2", "wOF2 font", false},
+            };
+            // what gzip -9 -n leaves of the text files is not decoded by the pack, the magic in front is enough
+            std::vector<PackFile> gzip = plain;
+            for (auto &file : gzip)
+            {
+                if (file.path == "index.html" || file.path == "css/main.css")
+                {
+                    file.bytes = gzip_magic + file.bytes;
+                    file.gzip = true;
+                }
+            }
+
+            const std::string path = (std::filesystem::temp_directory_path() / "wui_bench_resources.pak").string();
+            bool ok = verifyPack("plain", plain, path);
+            ok &= verifyPack("gzip", gzip, path);
+
+            // other files, a newer format and an entry pointing past the data
+            const std::string foreign[] = {
+                png,
+                gzip_magic + html,
+                "WUIPAK 2\n\n",
+                "WUIPAK 1\n0 4 identity a.txt\n\nabc",
+                "WUIPAK 1\n0 4 identity\n\nabcd",
+                "WUIPAK 1\n0 4 identity a.txt\n",
+            };
+            size_t accepted = 0;
+            for (const auto &bytes : foreign)
+            {
+                ResourcePack pack;
+                accepted += writeFile(path, bytes) && pack.open(path);
+            }
+
+            ResourcePack pack;
+            std::filesystem::remove(path);
+            const bool missing_refused = !pack.open(path);
+
+            ok &= accepted == 0 && missing_refused;
+            printf("  %zu foreign files %s, missing file %s: %s\n", sizeof(foreign) / sizeof(foreign[0]),
+                   accepted ? "ACCEPTED" : "refused", missing_refused ? "refused" : "ACCEPTED", ok ? "ok" : "FAILED");
+            return ok;
+        }
+    }
+}
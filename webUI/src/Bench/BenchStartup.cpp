@@ -0,0 +1,53 @@
+#include "Bench/Harness.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "util/startup_report.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        // Phases marked from two threads at once keep one stamp, marking them again or reading an unreached phase
+        // changes nothing. Only phases the app marks around CEF are used, no other section reaches them.
+        bool startupReport(const Options &)
+        {
+            using namespace Startup;
+
+            const Phase raced[] = {CefInitialized, BrowserRequested, BrowserCreated};
+
+            std::atomic<bool> go{false};
+            auto marker = [&]()
+            {
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+                for (Phase phase : raced)
+                {
+                    mark(phase);
+                }
+            };
+            std::thread first(marker), second(marker);
+            go = true;
+            first.join();
+            second.join();
+
+            bool first_wins = true;
+            for (Phase phase : raced)
+            {
+                const double stamp = at(phase);
+                mark(phase);
+                first_wins &= stamp >= at(MainEntered) && at(phase) == stamp;
+            }
+            const bool unreached = at(LoadEnd) < 0;
+
+            const bool ok = at(MainEntered) >= 0 && first_wins && unreached;
+            printf("  phases marked from two threads %s, unreached phase %s: %s\n", first_wins ? "stamped once" : "RESTAMPED",
+                   unreached ? "unset" : "SET", ok ? "ok" : "FAILED");
+            return ok;
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include "Bench/DataChannelBench.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace WUI
+{
+    namespace
+    {
+        const char *const CHANNEL = "bench";
+        const char *const ACK_TOPICS[] = {"bench.ack.shared", "bench.ack.script"};
+        const char *const PATH_NAMES[] = {"shared", "script"};
+
+        double now()
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    DataChannelBench::DataChannelBench(CefRefPtr<DataChannels> channels, CefRefPtr<EventBus> bus, CefRefPtr<CefBrowser> browser, size_t floats)
+        : m_channels(channels), m_bus(bus), m_frame(browser->GetMainFrame()), m_floats(floats)
+    {
+        for (int path = 0; path < PATHS; path++)
+        {
+            m_subscriptions[path] = m_bus->subscribe(ACK_TOPICS[path], [this, path](const Bus::Value &value)
+                                                     { acked((Path)path, (uint64_t)value.number); });
+        }
+
+        m_subscriptions[PATHS] = m_bus->subscribe("bench.ready", [this](const Bus::Value &)
+                                                  {
+                                                      std::lock_guard<std::mutex> guard(l_pending);
+                                                      m_ready = true; });
+    }
+
+    DataChannelBench::~DataChannelBench()
+    {
+        for (BusSubscription subscription : m_subscriptions)
+        {
+            m_bus->unsubscribe(subscription);
+        }
+    }
+
+    std::string DataChannelBench::encodeScript(uint64_t generation, const float *data, size_t count)
+    {
+        std::string script = "wuiBenchScript(" + std::to_string(generation) + ",new Float32Array([";
+        script.reserve(script.size() + count * 12 + 4);
+
+        char number[32];
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto result = std::to_chars(number, number + sizeof(number), data[i]);
+            script.append(number, result.ptr);
+            script += ',';
+        }
+        script += "]))";
+        return script;
+    }
+
+    void DataChannelBench::acked(Path path, uint64_t generation)
+    {
+        const double time = now();
+
+        std::lock_guard<std::mutex> guard(l_pending);
+        auto &pending = m_pending[path];
+        auto sent = pending.find(generation);
+        if (sent == pending.end())
+        {
+            return;
+        }
+
+        m_results[path].latency.add(time - sent->second);
+
+        // the page skips generations it never saw, they are not coming back
+        pending.erase(pending.begin(), std::next(sent));
+    }
+
+    bool DataChannelBench::run(double seconds, int fps, double ready_timeout, const std::atomic<bool> &stop)
+    {
+        if (fps <= 0)
+        {
+            return false;
+        }
+
+        const double wait_start = now();
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> guard(l_pending);
+                if (m_ready)
+                {
+                    break;
+                }
+            }
+            if (stop || now() - wait_start > ready_timeout)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        std::vector<float> data(m_floats);
+        const auto interval = std::chrono::microseconds(1000000 / fps);
+
+        for (int path = 0; path < PATHS; path++)
+        {
+            Result &result = m_results[path];
+            uint64_t generation = 0; // of the last array sent, the bench is the only publisher on its channel
+
+            const double start = now();
+            auto next = std::chrono::steady_clock::now();
+            while (now() - start < seconds)
+            {
+                if (stop)
+                {
+                    return false;
+                }
+
+                // something that changes every frame, like entity positions
+                for (size_t i = 0; i < data.size(); i++)
+                {
+                    data[i] = std::sin((float)(i + result.sent));
+                }
+
+                // pending before the send, the page can ack before publish or ExecuteJavaScript returns
+                const double send_start = now();
+                const uint64_t expected = generation + 1;
+                {
+                    std::lock_guard<std::mutex> guard(l_pending);
+                    m_pending[path][expected] = send_start;
+                }
+
+                uint64_t sent = expected;
+                if (path == SHARED)
+                {
+                    sent = m_channels->publish(CHANNEL, data.data(), data.size());
+                }
+                else
+                {
+                    m_frame->ExecuteJavaScript(encodeScript(expected, data.data(), data.size()), "", 0);
+                }
+                const double send_end = now();
+
+                // 0 if nothing went out
+                if (sent != expected)
+                {
+                    std::lock_guard<std::mutex> guard(l_pending);
+                    m_pending[path].erase(expected);
+                }
+                generation = sent ? sent : generation;
+
+                result.send.add(send_end - send_start);
+                result.sent++;
+
+                next += interval;
+                std::this_thread::sleep_until(next);
+            }
+
+            // the last acks are still on their way
+            for (int wait = 0; wait < 10 && !stop; wait++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            result.elapsed = now() - start;
+        }
+        return !stop;
+    }
+
+    void DataChannelBench::report(FILE *out)
+    {
+        std::lock_guard<std::mutex> guard(l_pending);
+
+        const double megabytes = m_floats * sizeof(float) / 1e6;
+        fprintf(out, "data channel bench: %zu floats (%.2f MB) per frame\n", m_floats, megabytes);
+        fprintf(out, "  %-8s %8s %8s %10s %12s %12s %12s\n", "path", "sent", "acked", "MB/s", "send p50 ms", "lat p50 ms", "lat p99 ms");
+        for (int path = 0; path < PATHS; path++)
+        {
+            const Result &result = m_results[path];
+            fprintf(out, "  %-8s %8zu %8zu %10.1f %12.3f %12.3f %12.3f\n", PATH_NAMES[path], result.sent, result.latency.count(),
+                    result.elapsed > 0 ? result.latency.count() * megabytes / result.elapsed : 0.0,
+                    result.send.percentile(0.5) * 1000, result.latency.percentile(0.5) * 1000, result.latency.percentile(0.99) * 1000);
+        }
+    }
+}
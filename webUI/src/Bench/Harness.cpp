@@ -0,0 +1,15 @@
+#include "Bench/Harness.hpp"
+
+namespace WUI
+{
+    namespace Bench
+    {
+        CefRefPtr<RenderHandler> headlessHandler(int width, int height, RenderSettings settings)
+        {
+            settings.width = width;
+            settings.height = height;
+            settings.headless = true;
+            return new RenderHandler(settings);
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#include "BrowserApp.hpp"
+#include "Resources/AppScheme.hpp"
+
+namespace WUI
+{
+    BrowserApp::BrowserApp()
+        : m_render_process_handler(new RenderProcessHandler())
+    {
+        al_init_user_event_source(&m_pump_event_source);
+    }
+
+    BrowserApp::~BrowserApp()
+    {
+        al_destroy_user_event_source(&m_pump_event_source);
+    }
+
+    void BrowserApp::OnRegisterCustomSchemes(CefRawPtr<CefSchemeRegistrar> registrar)
+    {
+        registerAppScheme(registrar);
+    }
+
+    void BrowserApp::OnScheduleMessagePumpWork(int64_t delay_ms)
+    {
+        ALLEGRO_EVENT event = {};
+        event.user.type = WUI_EVENT_PUMP_WORK;
+        event.user.data1 = (intptr_t)delay_ms;
+
+        // the render loop owns the queue and calls CefDoMessageLoopWork, we only wake it up
+        al_emit_user_event(&m_pump_event_source, &event, nullptr);
+    }
+}
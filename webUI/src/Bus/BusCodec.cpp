@@ -0,0 +1,130 @@
+#include "Bus/BusCodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace WUI
+{
+    namespace Bus
+    {
+        template <typename T>
+        static void put(std::vector<uint8_t> &bytes, T value)
+        {
+            const size_t at = bytes.size();
+            bytes.resize(at + sizeof(T));
+            memcpy(bytes.data() + at, &value, sizeof(T));
+        }
+
+        template <typename T>
+        static bool get(const uint8_t *data, size_t size, size_t &offset, T &value)
+        {
+            if (offset > size || size - offset < sizeof(T))
+            {
+                return false;
+            }
+            memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        BatchWriter::BatchWriter()
+        {
+            clear();
+        }
+
+        void BatchWriter::clear()
+        {
+            m_bytes.clear();
+            m_count = 0;
+            put<uint32_t>(m_bytes, MAGIC);
+            put<uint32_t>(m_bytes, 0);
+        }
+
+        void BatchWriter::add(const std::string &topic, const Value &value, uint8_t flags)
+        {
+            const uint16_t topic_length = (uint16_t)std::min<size_t>(topic.size(), UINT16_MAX);
+
+            put<uint8_t>(m_bytes, flags);
+            put<uint16_t>(m_bytes, topic_length);
+            m_bytes.insert(m_bytes.end(), topic.begin(), topic.begin() + topic_length);
+            put<uint8_t>(m_bytes, (uint8_t)value.type);
+
+            switch (value.type)
+            {
+            case Value::Type::Null:
+                break;
+            case Value::Type::Bool:
+                put<uint8_t>(m_bytes, value.number != 0);
+                break;
+            case Value::Type::Number:
+                put<double>(m_bytes, value.number);
+                break;
+            case Value::Type::String:
+                put<uint32_t>(m_bytes, (uint32_t)value.string.size());
+                m_bytes.insert(m_bytes.end(), value.string.begin(), value.string.end());
+                break;
+            }
+
+            // the count in the header is always current, bytes() is a complete batch at any point
+            m_count++;
+            memcpy(m_bytes.data() + 4, &m_count, sizeof(m_count));
+        }
+
+        bool decodeHeader(const uint8_t *data, size_t size, uint32_t &count)
+        {
+            size_t offset = 0;
+            uint32_t magic;
+            return get(data, size, offset, magic) && magic == MAGIC && get(data, size, offset, count);
+        }
+
+        bool decodeEvent(const uint8_t *data, size_t size, size_t &offset, std::string &topic, Value &value, uint8_t &flags)
+        {
+            uint16_t topic_length;
+            uint8_t type;
+            if (!get(data, size, offset, flags) || !get(data, size, offset, topic_length) || size - offset < topic_length)
+            {
+                return false;
+            }
+            topic.assign((const char *)data + offset, topic_length);
+            offset += topic_length;
+
+            if (!get(data, size, offset, type))
+            {
+                return false;
+            }
+
+            value.type = (Value::Type)type;
+            value.number = 0;
+            value.string.clear();
+            switch (value.type)
+            {
+            case Value::Type::Null:
+                return true;
+            case Value::Type::Bool:
+            {
+                uint8_t flag;
+                if (!get(data, size, offset, flag))
+                {
+                    return false;
+                }
+                value.number = flag;
+                return true;
+            }
+            case Value::Type::Number:
+                return get(data, size, offset, value.number);
+            case Value::Type::String:
+            {
+                uint32_t length;
+                if (!get(data, size, offset, length) || size - offset < length)
+                {
+                    return false;
+                }
+                value.string.assign((const char *)data + offset, length);
+                offset += length;
+                return true;
+            }
+            }
+            return false;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "DataChannels.hpp"
+#include "util/trace.hpp"
+
+#include <include/base/cef_logging.h>
+#include <include/cef_shared_process_message_builder.h>
+
+namespace WUI
+{
+    uint64_t DataChannels::publish(const std::string &name, Bus::DataType type, size_t count, const std::function<void(void *)> &fill)
+    {
+        TRACE_SPAN("data publish");
+
+        CefRefPtr<CefFrame> frame;
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> guard(l_channels);
+            if (!m_frame)
+            {
+                return 0;
+            }
+            frame = m_frame;
+            generation = ++m_generations[name];
+        }
+
+        CefRefPtr<CefSharedProcessMessageBuilder> builder =
+            CefSharedProcessMessageBuilder::Create(Bus::DATA_MESSAGE_NAME, Bus::dataRegionSize(name.size(), type, count));
+        if (!builder || !builder->IsValid())
+        {
+            DLOG(WARNING) << "[Data] no shared memory for " << count << " elements of " << name;
+            return 0;
+        }
+
+        void *memory = builder->Memory();
+        Bus::writeDataHeader(memory, name, type, generation, count);
+        fill((uint8_t *)memory + Bus::dataOffset(name.size()));
+
+        // CefFrame may be used from any thread in the browser process
+        frame->SendProcessMessage(PID_RENDERER, builder->Build());
+
+        m_published++;
+        m_bytes += count * Bus::dataTypeSize(type);
+        return generation;
+    }
+
+    void DataChannels::setBrowser(CefRefPtr<CefBrowser> browser)
+    {
+        std::lock_guard<std::mutex> guard(l_channels);
+        m_frame = browser ? browser->GetMainFrame() : nullptr;
+    }
+}
@@ -0,0 +1,180 @@
+#include "EventBus.hpp"
+#include "util/trace.hpp"
+
+#include <include/base/cef_logging.h>
+#include <include/cef_task.h>
+
+#include <algorithm>
+
+namespace WUI
+{
+    namespace
+    {
+        class FlushTask : public CefTask
+        {
+        private:
+            CefRefPtr<EventBus> m_bus;
+
+        public:
+            explicit FlushTask(CefRefPtr<EventBus> bus)
+                : m_bus(bus)
+            {
+            }
+
+            virtual void Execute() override
+            {
+                m_bus->flush();
+            }
+
+            IMPLEMENT_REFCOUNTING(FlushTask);
+        };
+    }
+
+    BusSubscription EventBus::subscribe(const std::string &topic, BusHandler handler)
+    {
+        std::lock_guard<std::mutex> guard(l_subscribers);
+        const BusSubscription id = m_next_subscription++;
+        m_subscribers[topic].emplace_back(id, std::move(handler));
+        m_topics[id] = topic;
+        return id;
+    }
+
+    void EventBus::unsubscribe(BusSubscription id)
+    {
+        std::lock_guard<std::mutex> guard(l_subscribers);
+        auto topic = m_topics.find(id);
+        if (topic == m_topics.end())
+        {
+            return;
+        }
+
+        auto &handlers = m_subscribers[topic->second];
+        handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [id](const auto &handler)
+                                      { return handler.first == id; }),
+                       handlers.end());
+        m_topics.erase(topic);
+    }
+
+    void EventBus::publish(const std::string &topic, Bus::Value value)
+    {
+        {
+            std::lock_guard<std::mutex> guard(l_outgoing);
+            m_events.add(topic, value);
+        }
+        scheduleFlush();
+    }
+
+    void EventBus::set(const std::string &topic, Bus::Value value)
+    {
+        {
+            std::lock_guard<std::mutex> guard(l_outgoing);
+            m_state[topic] = std::move(value);
+        }
+        scheduleFlush();
+    }
+
+    void EventBus::setBrowser(CefRefPtr<CefBrowser> browser)
+    {
+        m_browser = browser;
+        flush();
+    }
+
+    void EventBus::setFrameRate(int fps)
+    {
+        m_flush_delay_ms = std::max(1, 1000 / std::max(fps, 1));
+    }
+
+    void EventBus::scheduleFlush()
+    {
+        // the first event of a frame schedules the batch, the rest only append to it
+        if (!m_flush_scheduled.exchange(true))
+        {
+            CefPostDelayedTask(TID_UI, new FlushTask(this), m_flush_delay_ms);
+        }
+    }
+
+    void EventBus::flush()
+    {
+        TRACE_SPAN("bus flush");
+
+        // kept until setBrowser sends it, nothing is dropped meanwhile
+        if (!m_browser)
+        {
+            m_flush_scheduled = false;
+            return;
+        }
+
+        CefRefPtr<CefProcessMessage> message;
+        uint32_t count = 0;
+        {
+            std::lock_guard<std::mutex> guard(l_outgoing);
+            m_flush_scheduled = false;
+
+            for (const auto &state : m_state)
+            {
+                m_events.add(state.first, state.second, Bus::FLAG_STATE);
+            }
+            m_state.clear();
+
+            if (m_events.empty())
+            {
+                return;
+            }
+
+            count = m_events.count();
+            message = CefProcessMessage::Create(Bus::MESSAGE_NAME);
+            message->GetArgumentList()->SetBinary(0, CefBinaryValue::Create(m_events.bytes().data(), m_events.bytes().size()));
+            m_events.clear();
+        }
+
+        m_browser->GetMainFrame()->SendProcessMessage(PID_RENDERER, message);
+        m_events_sent += count;
+        m_messages_sent++;
+    }
+
+    bool EventBus::onProcessMessage(CefRefPtr<CefProcessMessage> message)
+    {
+        if (message->GetName().ToString() != Bus::MESSAGE_NAME)
+        {
+            return false;
+        }
+
+        CefRefPtr<CefBinaryValue> batch = message->GetArgumentList()->GetBinary(0);
+        if (!batch)
+        {
+            DLOG(WARNING) << "[Bus] message without a batch";
+            return true;
+        }
+
+        // copied out, the handlers may subscribe and unsubscribe
+        std::vector<BusHandler> handlers;
+        const bool ok = Bus::decode((const uint8_t *)batch->GetRawData(), batch->GetSize(),
+                                    [&](const std::string &topic, const Bus::Value &value, uint8_t)
+                                    {
+                                        handlers.clear();
+                                        {
+                                            std::lock_guard<std::mutex> guard(l_subscribers);
+                                            auto subscribers = m_subscribers.find(topic);
+                                            if (subscribers == m_subscribers.end())
+                                            {
+                                                return;
+                                            }
+                                            for (const auto &subscriber : subscribers->second)
+                                            {
+                                                handlers.push_back(subscriber.second);
+                                            }
+                                        }
+
+                                        for (const auto &handler : handlers)
+                                        {
+                                            handler(value);
+                                        }
+                                    });
+
+        if (!ok)
+        {
+            DLOG(WARNING) << "[Bus] malformed batch from the page";
+        }
+        return true;
+    }
+}
@@ -2,6 +2,8 @@
 
 #include "util/scope_guard.hpp"
 
+#include <algorithm>
+
 namespace WUI
 {
     InputManager *InputManager::m_instance = nullptr;
@@ -23,6 +25,7 @@ namespace WUI
     }
 
     InputManager::InputManager()
+        : m_dispatch(DISPATCH_THREADS)
     {
         // get communication from gamemanager
 
@@ -37,6 +40,7 @@ namespace WUI
 
         al_register_event_source(m_InputManager_event_queue, al_get_mouse_event_source());
         al_register_event_source(m_InputManager_event_queue, al_get_keyboard_event_source());
+        al_register_event_source(m_InputManager_event_queue, &m_InputManager_event_source);
 
         m_input_thread = std::thread([=]() -> void
                                      { this->input_loop(); });
@@ -73,8 +77,26 @@ namespace WUI
         {
             ALLEGRO_EVENT event;
 
-            // Fetch the event (if one exists)
-            al_wait_for_event(m_InputManager_event_queue, &event);
+            m_coalescer.setInterval(m_move_interval.load(std::memory_order_relaxed));
+
+            // Fetch the event (if one exists), or wake when coalesced input is due
+            if (m_coalescer.hasPending())
+            {
+                const double wait = m_coalescer.deadline() - al_get_time();
+                if (wait <= 0 || !al_wait_for_event_timed(m_InputManager_event_queue, &event, (float)wait))
+                {
+                    flush_coalesced();
+                    continue;
+                }
+            }
+            else
+            {
+                al_wait_for_event(m_InputManager_event_queue, &event);
+            }
+            if (!m_running)
+            {
+                break;
+            }
 
             // Handle the event
 
@@ -87,9 +109,22 @@ namespace WUI
                 m_mouse_state.y = event.mouse.y;
                 l_mouse_state.unlock();
 
-                convertMouseEvent(event, cef_mouse_event);
-
-                m_browser_host->SendMouseMoveEvent(cef_mouse_event, false);
+                // a 1000 Hz mouse would post every move into CEF, each one a possible layout and paint.
+                // Only the latest position per UI frame goes out, wheel ticks add up meanwhile.
+                if (event.mouse.dx || event.mouse.dy)
+                {
+                    m_coalescer.move(event.mouse.x, event.mouse.y);
+                    m_stats.moves_received++;
+                }
+                if (event.mouse.dz || event.mouse.dw)
+                {
+                    m_coalescer.wheel(event.mouse.dz, event.mouse.dw);
+                    m_stats.wheel_received++;
+                }
+                if (m_coalescer.due(al_get_time()))
+                {
+                    flush_coalesced();
+                }
                 // DLOG(INFO) << "mouse moved to " << event.mouse.x << " " << event.mouse.y;
 
                 break;
@@ -108,8 +143,14 @@ namespace WUI
             case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
                 DLOG(INFO) << "mouse DOWN Button " << (event.mouse.button == 1 ? "left" : "right") << "(" << event.mouse.button << ">2 = other) @ " << event.mouse.x << " " << event.mouse.y;
 
+                // the page has to see the pointer arrive before it is pressed there
+                flush_coalesced();
                 convertMouseEvent(event, cef_mouse_event);
                 m_browser_host->SendMouseClickEvent(cef_mouse_event, event.mouse.button == 1 ? MBT_LEFT : MBT_RIGHT, false, 1);
+                if (LatencyProbe *probe = m_latency_probe.load(std::memory_order_relaxed))
+                {
+                    probe->inputSent(event.any.timestamp);
+                }
 
                 // TODO some kind of system to differenciate if the UI consumed the event or not?
                 // possibly only solvable JS side.
@@ -120,6 +161,7 @@ namespace WUI
             case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
                 DLOG(INFO) << "mouse UP Button " << (event.mouse.button == 1 ? "left" : "right") << "(" << event.mouse.button << ">2 = other) @ " << event.mouse.x << " " << event.mouse.y;
 
+                flush_coalesced();
                 convertMouseEvent(event, cef_mouse_event);
                 m_browser_host->SendMouseClickEvent(cef_mouse_event, event.mouse.button == 1 ? MBT_LEFT : MBT_RIGHT, true, 1);
 
@@ -146,12 +188,67 @@ namespace WUI
                 DLOG(INFO) << "[Input] event received: " << event.type;
                 break;
             }
-            al_emit_user_event(&m_InputManager_event_source, &event, nullptr);
+            dispatch(event);
         }
         DLOG(INFO) << ("[Input] exited");
         return;
     }
 
+    void InputManager::flush_coalesced()
+    {
+        if (!m_coalescer.hasPending())
+        {
+            return;
+        }
+
+        const InputCoalescer::Pending pending = m_coalescer.take(al_get_time());
+
+        CefMouseEvent cef_event;
+        cef_event.x = pending.position.x;
+        cef_event.y = pending.position.y;
+        cef_event.modifiers = 0; // TODO mouse input modifiers
+
+        if (pending.move)
+        {
+            m_browser_host->SendMouseMoveEvent(cef_event, false);
+            m_stats.moves_forwarded++;
+        }
+
+        // same scale and directions as cefclient on linux: wheel up scrolls up, a tick is 40 px
+        if (pending.wheel_z || pending.wheel_w)
+        {
+            m_browser_host->SendMouseWheelEvent(cef_event, -pending.wheel_w * WHEEL_TICK_PX, pending.wheel_z * WHEEL_TICK_PX);
+            m_stats.wheel_forwarded++;
+        }
+    }
+
+    void InputManager::set_ui_frame_rate(int fps)
+    {
+        m_move_interval.store(1.0 / std::max(fps, 1), std::memory_order_relaxed);
+    }
+
+    void InputManager::set_latency_probe(LatencyProbe *probe)
+    {
+        m_latency_probe = probe;
+    }
+
+    void InputManager::inject(ALLEGRO_EVENT event)
+    {
+        // timestamped like a real event, the latency probe measures from here
+        event.any.timestamp = al_get_time();
+        al_emit_user_event(&m_InputManager_event_source, &event, nullptr);
+    }
+
+    InputStats InputManager::get_stats() const
+    {
+        InputStats stats;
+        stats.moves_received = m_stats.moves_received.load(std::memory_order_relaxed);
+        stats.moves_forwarded = m_stats.moves_forwarded.load(std::memory_order_relaxed);
+        stats.wheel_received = m_stats.wheel_received.load(std::memory_order_relaxed);
+        stats.wheel_forwarded = m_stats.wheel_forwarded.load(std::memory_order_relaxed);
+        return stats;
+    }
+
     vec2i InputManager::get_mouse_position()
     {
         l_mouse_state.lock();
@@ -160,60 +257,246 @@ namespace WUI
         return ret;
     }
 
-    bool InputManager::wait_for_key(int keycode)
+    InputSubscription InputManager::file(Route route, int value, Subscriber subscriber)
     {
-        auto queue = al_create_event_queue();
-        al_register_event_source(queue, &m_InputManager_event_source);
-        bool exit = false;
-        while (!exit)
+        mg8::ScopeGuard guard(l_subscribers);
+
+        // nothing will ever fire again, awaitables resolve right away
+        if (!m_running)
         {
-            ALLEGRO_EVENT event;
-            al_wait_for_event(queue, &event);
-            if (event.type == ALLEGRO_EVENT_KEY_DOWN)
+            if (subscriber.promise)
             {
-                exit = (event.keyboard.keycode == keycode);
+                subscriber.promise->set_value(std::nullopt);
             }
+            return 0;
         }
-        al_unregister_event_source(queue, &m_InputManager_event_source);
-        al_destroy_event_queue(queue);
-        return true;
+
+        const InputSubscription id = m_next_subscription++;
+        subscriber.id = id;
+
+        switch (route)
+        {
+        case Route::Type:
+            m_by_type[value].push_back(std::move(subscriber));
+            break;
+        case Route::Key:
+            m_by_key[value].push_back(std::move(subscriber));
+            break;
+        case Route::MouseButton:
+            for (int button = 0; button < MOUSE_BUTTONS; button++)
+            {
+                if (value & (1u << button))
+                {
+                    m_by_button[button].push_back(subscriber);
+                }
+            }
+            break;
+        }
+
+        m_filings[id] = {route, value};
+        return id;
     }
 
-    bool InputManager::wait_for_mouse_button(int button, vec2i &mouse_pos)
+    void InputManager::unfile(InputSubscription id)
     {
-        DLOG(INFO) << "[Input] waiting for mouse button " << button;
+        auto filing = m_filings.find(id);
+        if (filing == m_filings.end())
+        {
+            return;
+        }
 
-        auto queue = al_create_event_queue();
-        al_register_event_source(queue, &m_InputManager_event_source);
-        bool exit = false;
-        while (!exit)
+        auto erase = [id](std::vector<Subscriber> &bucket)
         {
-            ALLEGRO_EVENT event;
-            al_wait_for_event(queue, &event);
+            bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [id](const Subscriber &subscriber)
+                                        { return subscriber.id == id; }),
+                         bucket.end());
+        };
+
+        const int value = filing->second.value;
+        switch (filing->second.route)
+        {
+        case Route::Type:
+            erase(m_by_type[value]);
+            break;
+        case Route::Key:
+            erase(m_by_key[value]);
+            break;
+        case Route::MouseButton:
+            for (int button = 0; button < MOUSE_BUTTONS; button++)
+            {
+                if (value & (1u << button))
+                {
+                    erase(m_by_button[button]);
+                }
+            }
+            break;
+        }
+
+        m_filings.erase(filing);
+    }
 
-            if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN)
+    InputSubscription InputManager::subscribe(ALLEGRO_EVENT_TYPE type, InputHandler handler)
+    {
+        return file(Route::Type, (int)type, {0, std::make_shared<InputHandler>(std::move(handler)), nullptr});
+    }
+
+    InputSubscription InputManager::subscribe_key(int keycode, InputHandler handler)
+    {
+        return file(Route::Key, keycode, {0, std::make_shared<InputHandler>(std::move(handler)), nullptr});
+    }
+
+    InputSubscription InputManager::subscribe_mouse_button(int button_mask, InputHandler handler)
+    {
+        return file(Route::MouseButton, button_mask, {0, std::make_shared<InputHandler>(std::move(handler)), nullptr});
+    }
+
+    void InputManager::unsubscribe(InputSubscription id)
+    {
+        mg8::ScopeGuard guard(l_subscribers);
+        unfile(id);
+    }
+
+    InputAwaitable InputManager::next_key(int keycode)
+    {
+        auto promise = std::make_shared<std::promise<std::optional<ALLEGRO_EVENT>>>();
+        InputAwaitable result = promise->get_future();
+        file(Route::Key, keycode, {0, nullptr, std::move(promise)});
+        return result;
+    }
+
+    InputAwaitable InputManager::next_mouse_button(int button_mask)
+    {
+        auto promise = std::make_shared<std::promise<std::optional<ALLEGRO_EVENT>>>();
+        InputAwaitable result = promise->get_future();
+        file(Route::MouseButton, button_mask, {0, nullptr, std::move(promise)});
+        return result;
+    }
+
+    void InputManager::collect(std::vector<Subscriber> &bucket)
+    {
+        for (const Subscriber &subscriber : bucket)
+        {
+            m_matched.push_back(subscriber);
+        }
+    }
+
+    void InputManager::dispatch(const ALLEGRO_EVENT &event)
+    {
+        m_matched.clear();
+        {
+            mg8::ScopeGuard guard(l_subscribers);
+
+            // at most three hash lookups, however many subscribers there are
+            auto type = m_by_type.find(event.type);
+            if (type != m_by_type.end())
+            {
+                collect(type->second);
+            }
+
+            if (event.type == ALLEGRO_EVENT_KEY_DOWN)
             {
-                exit = (event.mouse.button & button);
-                if (exit)
+                auto key = m_by_key.find(event.keyboard.keycode);
+                if (key != m_by_key.end())
                 {
-                    mouse_pos = {event.mouse.x, event.mouse.y};
+                    collect(key->second);
                 }
             }
+
+            if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN && event.mouse.button >= 1 && event.mouse.button <= MOUSE_BUTTONS)
+            {
+                collect(m_by_button[event.mouse.button - 1]);
+            }
+
+            // awaitables are done after their first event
+            for (const Subscriber &subscriber : m_matched)
+            {
+                if (subscriber.promise)
+                {
+                    unfile(subscriber.id);
+                }
+            }
+        }
+
+        for (const Subscriber &subscriber : m_matched)
+        {
+            if (subscriber.promise)
+            {
+                subscriber.promise->set_value(event);
+            }
+            else
+            {
+                m_dispatch.post(subscriber.id, [handler = subscriber.handler, event]()
+                                { (*handler)(event); });
+            }
+        }
+    }
+
+    bool InputManager::wait_for_key(int keycode)
+    {
+        return next_key(keycode).get().has_value();
+    }
+
+    bool InputManager::wait_for_mouse_button(int button_mask, vec2i &mouse_pos)
+    {
+        DLOG(INFO) << "[Input] waiting for mouse button " << button_mask;
+
+        const auto event = next_mouse_button(button_mask).get();
+        if (!event)
+        {
+            return false;
         }
-        al_unregister_event_source(queue, &m_InputManager_event_source);
-        al_destroy_event_queue(queue);
 
+        mouse_pos = {event->mouse.x, event->mouse.y};
         return true;
     }
 
     void InputManager::shutdown()
     {
         DLOG(INFO) << ("[Input] shutting down");
-        m_running = false;
+
+        std::vector<std::shared_ptr<std::promise<std::optional<ALLEGRO_EVENT>>>> waiting;
+        {
+            mg8::ScopeGuard guard(l_subscribers);
+            m_running = false;
+
+            // a mask subscription sits in several buckets, each awaitable is resolved once
+            auto drop = [&](std::vector<Subscriber> &bucket)
+            {
+                for (const Subscriber &subscriber : bucket)
+                {
+                    if (subscriber.promise && std::find(waiting.begin(), waiting.end(), subscriber.promise) == waiting.end())
+                    {
+                        waiting.push_back(subscriber.promise);
+                    }
+                }
+                bucket.clear();
+            };
+
+            for (auto &bucket : m_by_type)
+            {
+                drop(bucket.second);
+            }
+            for (auto &bucket : m_by_key)
+            {
+                drop(bucket.second);
+            }
+            for (auto &bucket : m_by_button)
+            {
+                drop(bucket);
+            }
+            m_filings.clear();
+        }
+
+        // waiters get their nothing outside the lock, they may subscribe again right away
+        for (auto &promise : waiting)
+        {
+            promise->set_value(std::nullopt);
+        }
+
         ALLEGRO_EVENT ev = {};
         ev.user.data1 = (int)1;
         ev.type = 1;
         al_emit_user_event(&m_InputManager_event_source, &ev, nullptr);
     }
 
-}
\ No newline at end of file
+}
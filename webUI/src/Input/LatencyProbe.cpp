@@ -0,0 +1,121 @@
+#include "Input/LatencyProbe.hpp"
+
+#include <algorithm>
+
+namespace WUI
+{
+    uint32_t LatencyProbe::decode(const void *bgra, int width, int height)
+    {
+        if (width < 1 || height < 1)
+        {
+            return NO_MARKER;
+        }
+
+        const uint8_t *pixel = static_cast<const uint8_t *>(bgra);
+        if (pixel[0] != SIGNATURE)
+        {
+            return NO_MARKER;
+        }
+        return pixel[2] | pixel[1] << 8;
+    }
+
+    void LatencyProbe::inputSent(double time)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        // a click the page never saw (still loading) would shift every later pairing by one
+        if (!m_ready)
+        {
+            return;
+        }
+
+        m_sent++;
+        m_input_times.push_back(time);
+    }
+
+    void LatencyProbe::presented(uint32_t marker, double time)
+    {
+        if (marker == NO_MARKER)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        if (!m_ready)
+        {
+            // whatever the page counted before we started listening is the baseline
+            m_ready = true;
+            m_presented = marker;
+            m_sent = marker;
+            return;
+        }
+
+        // the marker is 16 bits, the counters are not
+        const uint64_t advanced = (marker - (uint32_t)(m_presented & 0xffff)) & 0xffff;
+        for (uint64_t i = 0; i < advanced && !m_input_times.empty(); i++)
+        {
+            m_latencies_ms.add((time - m_input_times.front()) * 1000);
+            m_input_times.pop_front();
+        }
+        m_presented += advanced;
+    }
+
+    bool LatencyProbe::ready()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_ready;
+    }
+
+    size_t LatencyProbe::count()
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_latencies_ms.count();
+    }
+
+    void LatencyProbe::report(FILE *out)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        const size_t count = m_latencies_ms.count();
+        fprintf(out, "input to photon latency, %zu clicks", count);
+        if (!count)
+        {
+            fprintf(out, "\n");
+            return;
+        }
+        fprintf(out, ": p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+                m_latencies_ms.percentile(0.5), m_latencies_ms.percentile(0.9),
+                m_latencies_ms.percentile(0.99), m_latencies_ms.percentile(1));
+
+        int buckets[BUCKETS + 1] = {};
+        int largest = 1;
+        for (double value : m_latencies_ms.values())
+        {
+            const int bucket = std::min((int)(value / BUCKET_MS), BUCKETS);
+            largest = std::max(largest, ++buckets[bucket]);
+        }
+
+        const int width = 50;
+        for (int bucket = 0; bucket <= BUCKETS; bucket++)
+        {
+            if (!buckets[bucket])
+            {
+                continue;
+            }
+            if (bucket < BUCKETS)
+            {
+                fprintf(out, "  %5.0f - %5.0f ms %6d ", bucket * BUCKET_MS, (bucket + 1) * BUCKET_MS, buckets[bucket]);
+            }
+            else
+            {
+                fprintf(out, "  %5.0f+        ms %6d ", BUCKETS * BUCKET_MS, buckets[bucket]);
+            }
+            for (int i = 0; i < buckets[bucket] * width / largest; i++)
+            {
+                fputc('#', out);
+            }
+            fputc('\n', out);
+        }
+    }
+}
@@ -0,0 +1,182 @@
+#include "Objects/BallCollider.hpp"
+#include "util/trace.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace WUI
+{
+    // fraction of the overlap removed per tick, the full amount overshoots in piles where contacts add up
+    static const float SEPARATION = 0.8f;
+
+    // balls per parallel chunk, enough that claiming one costs nothing next to resolving it
+    static const size_t GRAIN = 1024;
+
+    void BallCollider::rebuild(const float *x, const float *y, const float *radius, size_t count,
+                               float width, float height, uint64_t layout_version)
+    {
+        // radii never change while the layout stays the same
+        if (layout_version != m_layout_version)
+        {
+            m_max_radius = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                m_max_radius = std::max(m_max_radius, radius[i]);
+            }
+        }
+
+        // touching centres are at most two of the largest radii apart, one cell in any direction
+        m_grid.build(x, y, count, 2 * m_max_radius, width, height);
+        m_layout_version = layout_version;
+    }
+
+    void BallCollider::resolve(float *x, float *y, float *vx, float *vy, const float *radius, size_t count,
+                               float width, float height, uint64_t layout_version, TaskScheduler &scheduler)
+    {
+        const size_t grain = TaskScheduler::alignedGrain<float>(GRAIN);
+
+        {
+            TRACE_SPAN("broadphase");
+            rebuild(x, y, radius, count, width, height, layout_version);
+
+            m_x.resize(count);
+            m_y.resize(count);
+            m_vx.resize(count);
+            m_vy.resize(count);
+            m_radius.resize(count);
+
+            const uint32_t *order = m_grid.order();
+            scheduler.parallelFor(count, grain, [&](size_t begin, size_t end)
+                                  {
+                for (size_t k = begin; k < end; k++)
+                {
+                    const uint32_t i = order[k];
+                    m_x[k] = x[i];
+                    m_y[k] = y[i];
+                    m_vx[k] = vx[i];
+                    m_vy[k] = vy[i];
+                    m_radius[k] = radius[i];
+                } });
+        }
+
+        TRACE_SPAN("collisions");
+
+        m_out_x.resize(count);
+        m_out_y.resize(count);
+        m_out_vx.resize(count);
+        m_out_vy.resize(count);
+
+        scheduler.parallelFor(count, grain, [&](size_t begin, size_t end)
+                              { resolveRange(begin, end, width, height); });
+
+        // gathered back by ball, every chunk writes its own contiguous lines
+        const uint32_t *position = m_grid.positions();
+        scheduler.parallelFor(count, grain, [&](size_t begin, size_t end)
+                              {
+            for (size_t i = begin; i < end; i++)
+            {
+                const uint32_t k = position[i];
+                x[i] = m_out_x[k];
+                y[i] = m_out_y[k];
+                vx[i] = m_out_vx[k];
+                vy[i] = m_out_vy[k];
+            } });
+    }
+
+    void BallCollider::resolveRange(size_t begin, size_t end, float width, float height)
+    {
+        for (size_t k = begin; k < end; k++)
+        {
+            const float px = m_x[k];
+            const float py = m_y[k];
+            const float pvx = m_vx[k];
+            const float pvy = m_vy[k];
+            const float r = m_radius[k];
+            const float mass = r * r;
+
+            float push_x = 0, push_y = 0;
+            float dvx = 0, dvy = 0;
+            size_t candidates = 0;
+
+            m_grid.forEachNear(px, py, [&](uint32_t l) -> bool
+                               {
+                if (l == k)
+                {
+                    return true;
+                }
+                if (++candidates > MAX_CANDIDATES)
+                {
+                    return false;
+                }
+
+                const float dx = px - m_x[l];
+                const float dy = py - m_y[l];
+                const float reach = r + m_radius[l];
+                const float distance_sq = dx * dx + dy * dy;
+                if (distance_sq >= reach * reach)
+                {
+                    return true;
+                }
+
+                const float distance = std::sqrt(distance_sq);
+                float nx = 1, ny = 0;
+                if (distance > 0)
+                {
+                    nx = dx / distance;
+                    ny = dy / distance;
+                }
+                else if (k < l)
+                {
+                    // same spot, both sides agree on opposite directions by their grid order
+                    nx = -1;
+                }
+
+                // the other side of the pair takes the rest, so together they move the full amount
+                const float other_mass = m_radius[l] * m_radius[l];
+                const float share = other_mass / (mass + other_mass);
+                push_x += nx * (reach - distance) * share * SEPARATION;
+                push_y += ny * (reach - distance) * share * SEPARATION;
+
+                // elastic, only while approaching so separating balls don't get pulled back together
+                const float approach = (pvx - m_vx[l]) * nx + (pvy - m_vy[l]) * ny;
+                if (approach < 0)
+                {
+                    dvx -= 2 * share * approach * nx;
+                    dvy -= 2 * share * approach * ny;
+                }
+                return true; });
+
+            m_out_x[k] = std::min(std::max(px + push_x, 0.0f), width);
+            m_out_y[k] = std::min(std::max(py + push_y, 0.0f), height);
+            m_out_vx[k] = pvx + dvx;
+            m_out_vy[k] = pvy + dvy;
+        }
+    }
+
+    int64_t BallCollider::pick(float px, float py, const float *x, const float *y, const float *radius, size_t count,
+                               float width, float height, uint64_t layout_version)
+    {
+        // balls spawned or removed since the last tick are not in the grid yet
+        if (layout_version != m_layout_version)
+        {
+            rebuild(x, y, radius, count, width, height, layout_version);
+        }
+
+        // The grid was built before the last collision pass nudged the balls, far less than a cell, so the
+        // 3x3 neighbourhood still holds every candidate. Distances use the current positions.
+        const uint32_t *order = m_grid.order();
+        int64_t picked = -1;
+        m_grid.forEachNear(px, py, [&](uint32_t k) -> bool
+                           {
+            const uint32_t i = order[k];
+            const float dx = px - x[i];
+            const float dy = py - y[i];
+            if (dx * dx + dy * dy <= radius[i] * radius[i] && (int64_t)i > picked)
+            {
+                picked = i;
+            }
+            return true; });
+
+        return picked;
+    }
+}
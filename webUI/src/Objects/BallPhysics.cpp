@@ -0,0 +1,138 @@
+#include "Objects/BallPhysics.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#if WUI_X86
+#include <immintrin.h>
+#endif
+
+// the kernels are only bit identical if the compiler doesn't fuse x + v * dt into an fma on its own
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace WUI
+{
+    namespace BallPhysics
+    {
+        // Reference kernel. Written without branches like the SIMD ones: clamping is min/max and the reflection
+        // is a sign flip of the velocity component where the ball ended up outside.
+        static void stepScalar(float *x, float *y, float *vx, float *vy, size_t count,
+                               float width, float height, float delta_t)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const float nx = x[i] + vx[i] * delta_t;
+                const float ny = y[i] + vy[i] * delta_t;
+
+                const bool out_x = (nx < 0) | (nx > width);
+                const bool out_y = (ny < 0) | (ny > height);
+
+                x[i] = std::min(std::max(nx, 0.0f), width);
+                y[i] = std::min(std::max(ny, 0.0f), height);
+                vx[i] = out_x ? -vx[i] : vx[i];
+                vy[i] = out_y ? -vy[i] : vy[i];
+            }
+        }
+
+#if WUI_X86
+        // plain SSE, every cpu with SSSE3 has it
+        WUI_TARGET("ssse3")
+        static void stepSSE(float *x, float *y, float *vx, float *vy, size_t count,
+                            float width, float height, float delta_t)
+        {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 w = _mm_set1_ps(width);
+            const __m128 h = _mm_set1_ps(height);
+            const __m128 dt = _mm_set1_ps(delta_t);
+            const __m128 sign = _mm_set1_ps(-0.0f);
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), dt));
+                const __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), dt));
+
+                const __m128 out_x = _mm_or_ps(_mm_cmplt_ps(px, zero), _mm_cmpgt_ps(px, w));
+                const __m128 out_y = _mm_or_ps(_mm_cmplt_ps(py, zero), _mm_cmpgt_ps(py, h));
+
+                // operand order matches std::min/std::max in the scalar kernel, for NaN and -0 too
+                _mm_storeu_ps(x + i, _mm_min_ps(w, _mm_max_ps(zero, px)));
+                _mm_storeu_ps(y + i, _mm_min_ps(h, _mm_max_ps(zero, py)));
+                _mm_storeu_ps(vx + i, _mm_xor_ps(_mm_loadu_ps(vx + i), _mm_and_ps(out_x, sign)));
+                _mm_storeu_ps(vy + i, _mm_xor_ps(_mm_loadu_ps(vy + i), _mm_and_ps(out_y, sign)));
+            }
+            stepScalar(x + i, y + i, vx + i, vy + i, count - i, width, height, delta_t);
+        }
+
+        WUI_TARGET("avx2")
+        static void stepAVX2(float *x, float *y, float *vx, float *vy, size_t count,
+                             float width, float height, float delta_t)
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 w = _mm256_set1_ps(width);
+            const __m256 h = _mm256_set1_ps(height);
+            const __m256 dt = _mm256_set1_ps(delta_t);
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                // no fma on purpose, it would round differently than the scalar kernel
+                const __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(vx + i), dt));
+                const __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(vy + i), dt));
+
+                const __m256 out_x = _mm256_or_ps(_mm256_cmp_ps(px, zero, _CMP_LT_OQ), _mm256_cmp_ps(px, w, _CMP_GT_OQ));
+                const __m256 out_y = _mm256_or_ps(_mm256_cmp_ps(py, zero, _CMP_LT_OQ), _mm256_cmp_ps(py, h, _CMP_GT_OQ));
+
+                _mm256_storeu_ps(x + i, _mm256_min_ps(w, _mm256_max_ps(zero, px)));
+                _mm256_storeu_ps(y + i, _mm256_min_ps(h, _mm256_max_ps(zero, py)));
+                _mm256_storeu_ps(vx + i, _mm256_xor_ps(_mm256_loadu_ps(vx + i), _mm256_and_ps(out_x, sign)));
+                _mm256_storeu_ps(vy + i, _mm256_xor_ps(_mm256_loadu_ps(vy + i), _mm256_and_ps(out_y, sign)));
+            }
+            // remaining < 8 balls
+            stepSSE(x + i, y + i, vx + i, vy + i, count - i, width, height, delta_t);
+        }
+#endif
+
+        StepKernel stepKernel(Isa isa)
+        {
+            switch (isa)
+            {
+            case Isa::Scalar:
+                return stepScalar;
+#if WUI_X86
+            case Isa::SSSE3:
+                return stepSSE;
+            case Isa::AVX2:
+                return stepAVX2;
+#endif
+            default:
+                return nullptr;
+            }
+        }
+
+        Isa activeIsa()
+        {
+            return bestIsa();
+        }
+
+        // nullptr until the first step, see g_best_isa in cpu_isa.cpp
+        static std::atomic<StepKernel> g_kernel{nullptr};
+
+        void step(float *x, float *y, float *vx, float *vy, size_t count,
+                  float width, float height, float delta_t)
+        {
+            StepKernel kernel = g_kernel.load(std::memory_order_relaxed);
+            if (!kernel)
+            {
+                kernel = stepKernel(activeIsa());
+                g_kernel.store(kernel, std::memory_order_relaxed);
+            }
+            kernel(x, y, vx, vy, count, width, height, delta_t);
+        }
+    }
+}
@@ -0,0 +1,221 @@
+#include "Objects/BallSimulation.hpp"
+#include "util/trace.hpp"
+
+#include <chrono>
+
+namespace WUI
+{
+    static double steadySeconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void BallSnapshot::interpolate(float alpha, size_t begin, size_t end, float *out_x, float *out_y) const
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            out_x[i] = prev_x[i] + (x[i] - prev_x[i]) * alpha;
+            out_y[i] = prev_y[i] + (y[i] - prev_y[i]) * alpha;
+        }
+    }
+
+    Circles BallSnapshot::circles(const float *positions_x, const float *positions_y) const
+    {
+        Circles circles;
+        circles.x = positions_x;
+        circles.y = positions_y;
+        circles.radius = radius.data();
+        circles.color = color.data();
+        circles.count = size();
+        circles.layout_version = layout_version;
+        return circles;
+    }
+
+    BallSimulation::BallSimulation(FrameScheduler &frame_scheduler, float width, float height)
+        : m_width(width), m_height(height), m_frame_scheduler(frame_scheduler)
+    {
+    }
+
+    BallSimulation::~BallSimulation()
+    {
+        stop();
+    }
+
+    void BallSimulation::start()
+    {
+        if (m_running.exchange(true))
+        {
+            return;
+        }
+        m_thread = std::thread(&BallSimulation::run, this);
+    }
+
+    void BallSimulation::stop()
+    {
+        m_running = false;
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+
+        // whatever came in after the last tick, a pick left in the queue would break its promise and
+        // future.get() would throw (terminate without exceptions); the balls are this thread's now
+        applyCommands();
+    }
+
+    void BallSimulation::setBounds(float width, float height)
+    {
+        m_width.store(width, std::memory_order_relaxed);
+        m_height.store(height, std::memory_order_relaxed);
+    }
+
+    void BallSimulation::spawn(float x, float y)
+    {
+        BallCommand command;
+        command.positions.push_back(vec2f(x, y));
+        m_commands.push(std::move(command));
+    }
+
+    void BallSimulation::spawn(std::vector<vec2f> positions)
+    {
+        BallCommand command;
+        command.positions = std::move(positions);
+        m_commands.push(std::move(command));
+    }
+
+    void BallSimulation::remove(BallHandle handle)
+    {
+        BallCommand command;
+        command.type = BallCommand::Type::Remove;
+        command.handle = handle;
+        m_commands.push(std::move(command));
+    }
+
+    void BallSimulation::clear()
+    {
+        BallCommand command;
+        command.type = BallCommand::Type::Clear;
+        m_commands.push(std::move(command));
+    }
+
+    std::future<BallHandle> BallSimulation::pick(float x, float y)
+    {
+        BallCommand command;
+        command.type = BallCommand::Type::Pick;
+        command.positions.push_back(vec2f(x, y));
+        command.picked = std::make_shared<std::promise<BallHandle>>();
+
+        std::future<BallHandle> result = command.picked->get_future();
+        m_commands.push(std::move(command));
+        return result;
+    }
+
+    void BallSimulation::applyCommands()
+    {
+        BallCommand command;
+        while (m_commands.pop(command))
+        {
+            switch (command.type)
+            {
+            case BallCommand::Type::Spawn:
+                // exact reserves for single spawns would reallocate every time, leave those to vector growth
+                if (command.positions.size() > 1)
+                {
+                    m_balls.reserve(m_balls.size() + command.positions.size());
+                }
+                for (const auto &position : command.positions)
+                {
+                    m_balls.spawn(position.x, position.y);
+                }
+                break;
+            case BallCommand::Type::Remove:
+                m_balls.remove(command.handle);
+                break;
+            case BallCommand::Type::Clear:
+                m_balls.clear();
+                break;
+            case BallCommand::Type::Pick:
+                command.picked->set_value(m_balls.pick(command.positions[0].x, command.positions[0].y));
+                break;
+            }
+        }
+    }
+
+    const BallSnapshot *BallSimulation::latest()
+    {
+        // front() keeps the last taken tick when nothing new was published
+        m_snapshots.take();
+        const BallSnapshot &snapshot = m_snapshots.front();
+        return snapshot.tick ? &snapshot : nullptr;
+    }
+
+    void BallSimulation::run()
+    {
+        Trace::setThreadName("simulation");
+
+        double next_tick = steadySeconds();
+        while (m_running)
+        {
+            const double now = steadySeconds();
+            if (now < next_tick)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double>(next_tick - now));
+                continue;
+            }
+
+            // a stall (debugger, suspended machine, ...) is not replayed, balls just pause
+            if (now - next_tick > MAX_CATCHUP_TICKS * TICK_SECONDS)
+            {
+                next_tick = now;
+            }
+
+            next_tick += TICK_SECONDS;
+            tick(next_tick);
+        }
+    }
+
+    void BallSimulation::tick(double time)
+    {
+        TRACE_SPAN("simulation tick");
+
+        applyCommands();
+
+        BallSnapshot &snapshot = m_snapshots.back();
+        const size_t count = m_balls.size();
+        snapshot.prev_x.assign(m_balls.x(), m_balls.x() + count);
+        snapshot.prev_y.assign(m_balls.y(), m_balls.y() + count);
+
+        // a fixed step, so a slow frame can never push a ball further than one tick of travel
+        m_balls.update(m_width.load(std::memory_order_relaxed), m_height.load(std::memory_order_relaxed), TICK_SECONDS);
+
+        snapshot.x.assign(m_balls.x(), m_balls.x() + count);
+        snapshot.y.assign(m_balls.y(), m_balls.y() + count);
+
+        // the slots rotate, each one only copies the static components when it is behind
+        if (snapshot.layout_version != m_balls.layoutVersion())
+        {
+            snapshot.radius.assign(m_balls.radius(), m_balls.radius() + count);
+            snapshot.color.assign(m_balls.color(), m_balls.color() + count);
+            snapshot.layout_version = m_balls.layoutVersion();
+        }
+
+        publish(time);
+    }
+
+    void BallSimulation::publish(double time)
+    {
+        BallSnapshot &snapshot = m_snapshots.back();
+        snapshot.tick = ++m_tick;
+        snapshot.time = time;
+        const uint64_t layout = snapshot.layout_version;
+
+        m_snapshots.publish();
+
+        // the render loop idles while nothing moves, it has to learn about new or removed balls
+        if (layout != m_published_layout)
+        {
+            m_published_layout = layout;
+            m_frame_scheduler.invalidate(DAMAGE_ANIMATION);
+        }
+    }
+}
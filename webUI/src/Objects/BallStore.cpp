@@ -0,0 +1,154 @@
+#include "Objects/BallStore.hpp"
+#include "Objects/BallPhysics.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace WUI
+{
+    // balls per parallel chunk of the integration
+    static const size_t STEP_GRAIN = 8192;
+
+    BallHandle BallStore::spawn(float x, float y)
+    {
+        const float radius = 10 + rand() % 100;
+        const float speed = 200 + rand() % 200;
+        const float angle = 20 + rand() % 20;
+
+        // the direction is resolved once here, not every frame
+        return spawn(x, y, radius,
+                     vec2f(std::cos(angle), std::sin(angle)) * speed,
+                     al_map_rgb(rand() % 255, rand() % 255, rand() % 255));
+    }
+
+    BallHandle BallStore::spawn(float x, float y, float radius, vec2f velocity, ALLEGRO_COLOR color)
+    {
+        uint32_t slot;
+        if (m_free_slot != NO_SLOT)
+        {
+            slot = m_free_slot;
+            m_free_slot = m_slots[slot].dense;
+        }
+        else
+        {
+            slot = (uint32_t)m_slots.size();
+            m_slots.push_back({0, 0});
+        }
+
+        m_slots[slot].dense = (uint32_t)m_x.size();
+
+        m_x.push_back(x);
+        m_y.push_back(y);
+        m_radius.push_back(radius);
+        m_vx.push_back(velocity.x);
+        m_vy.push_back(velocity.y);
+        m_color.push_back(color);
+        m_owner.push_back(slot);
+        m_layout_version++;
+
+        return {slot, m_slots[slot].generation};
+    }
+
+    bool BallStore::alive(BallHandle handle) const
+    {
+        return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation &&
+               m_slots[handle.slot].dense < m_owner.size() && m_owner[m_slots[handle.slot].dense] == handle.slot;
+    }
+
+    bool BallStore::remove(BallHandle handle)
+    {
+        if (!alive(handle))
+        {
+            return false;
+        }
+
+        // move the last ball into the hole so the arrays stay dense
+        const uint32_t hole = m_slots[handle.slot].dense;
+        const uint32_t last = (uint32_t)m_x.size() - 1;
+        if (hole != last)
+        {
+            m_x[hole] = m_x[last];
+            m_y[hole] = m_y[last];
+            m_radius[hole] = m_radius[last];
+            m_vx[hole] = m_vx[last];
+            m_vy[hole] = m_vy[last];
+            m_color[hole] = m_color[last];
+            m_owner[hole] = m_owner[last];
+            m_slots[m_owner[hole]].dense = hole;
+        }
+
+        m_x.pop_back();
+        m_y.pop_back();
+        m_radius.pop_back();
+        m_vx.pop_back();
+        m_vy.pop_back();
+        m_color.pop_back();
+        m_owner.pop_back();
+
+        Slot &slot = m_slots[handle.slot];
+        slot.generation++;
+        slot.dense = m_free_slot;
+        m_free_slot = handle.slot;
+        m_layout_version++;
+
+        return true;
+    }
+
+    void BallStore::reserve(size_t count)
+    {
+        m_x.reserve(count);
+        m_y.reserve(count);
+        m_radius.reserve(count);
+        m_vx.reserve(count);
+        m_vy.reserve(count);
+        m_color.reserve(count);
+        m_owner.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    void BallStore::clear()
+    {
+        // every live slot goes back on the free list with a new generation
+        for (uint32_t slot : m_owner)
+        {
+            m_slots[slot].generation++;
+            m_slots[slot].dense = m_free_slot;
+            m_free_slot = slot;
+        }
+
+        m_x.clear();
+        m_y.clear();
+        m_radius.clear();
+        m_vx.clear();
+        m_vy.clear();
+        m_color.clear();
+        m_owner.clear();
+        m_layout_version++;
+    }
+
+    void BallStore::update(float width, float height, float delta_t, TaskScheduler &scheduler)
+    {
+        // memory bound, chunks large enough to amortize the hand off
+        scheduler.parallelFor(size(), TaskScheduler::alignedGrain<float>(STEP_GRAIN), [&](size_t begin, size_t end)
+                              { BallPhysics::step(m_x.data() + begin, m_y.data() + begin, m_vx.data() + begin, m_vy.data() + begin,
+                                                  end - begin, width, height, delta_t); });
+
+        m_collider.resolve(m_x.data(), m_y.data(), m_vx.data(), m_vy.data(), m_radius.data(), size(),
+                           width, height, m_layout_version, scheduler);
+        m_width = width;
+        m_height = height;
+    }
+
+    BallHandle BallStore::pick(float x, float y)
+    {
+        const int64_t index = m_collider.pick(x, y, m_x.data(), m_y.data(), m_radius.data(), size(),
+                                              m_width, m_height, m_layout_version);
+        if (index < 0)
+        {
+            return {};
+        }
+
+        const uint32_t slot = m_owner[index];
+        return {slot, m_slots[slot].generation};
+    }
+}
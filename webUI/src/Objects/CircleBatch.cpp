@@ -0,0 +1,188 @@
+#include "Objects/CircleBatch.hpp"
+
+#include <include/base/cef_logging.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace WUI
+{
+    CircleBatch::CircleBatch()
+    {
+        for (int lod = 0; lod < LOD_COUNT; lod++)
+        {
+            const int segments = LOD_SEGMENTS[lod];
+            for (int i = 0; i < segments; i++)
+            {
+                const double angle = 2 * M_PI * i / segments;
+                m_lods[lod].cos.push_back(std::cos(angle));
+                m_lods[lod].sin.push_back(std::sin(angle));
+            }
+        }
+    }
+
+    CircleBatch::~CircleBatch()
+    {
+        release();
+    }
+
+    void CircleBatch::release()
+    {
+        if (m_vertex_buffer)
+        {
+            al_destroy_vertex_buffer(m_vertex_buffer);
+            m_vertex_buffer = NULL;
+        }
+        if (m_index_buffer)
+        {
+            al_destroy_index_buffer(m_index_buffer);
+            m_index_buffer = NULL;
+        }
+        m_vertex_capacity = 0;
+        m_index_capacity = 0;
+        m_indices_uploaded = false;
+    }
+
+    int CircleBatch::lodFor(float radius)
+    {
+        // a chord of n segments deviates r * (1 - cos(pi / n)) from the circle
+        for (int lod = 0; lod < LOD_COUNT; lod++)
+        {
+            if (radius * (1 - std::cos(M_PI / LOD_SEGMENTS[lod])) <= MAX_ERROR)
+            {
+                return lod;
+            }
+        }
+        return LOD_COUNT - 1;
+    }
+
+    void CircleBatch::rebuildLayout(const Circles &circles)
+    {
+        const size_t count = circles.count;
+        const float *radius = circles.radius;
+
+        m_ball_lod.resize(count);
+        m_indices.clear();
+
+        // every circle is a center vertex followed by its rim, triangles fan out from the center
+        int base = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const int lod = lodFor(radius[i]);
+            const int segments = LOD_SEGMENTS[lod];
+            m_ball_lod[i] = (uint8_t)lod;
+
+            for (int k = 0; k < segments; k++)
+            {
+                m_indices.push_back(base);
+                m_indices.push_back(base + 1 + k);
+                m_indices.push_back(base + 1 + (k + 1) % segments);
+            }
+            base += segments + 1;
+        }
+
+        m_vertex_count = base;
+        m_layout_version = circles.layout_version;
+        m_indices_uploaded = false;
+    }
+
+    bool CircleBatch::ensureBuffers()
+    {
+        if (m_buffers_unsupported)
+        {
+            return false;
+        }
+
+        // grow only, by half again so steady spawning doesn't reallocate every frame
+        if (m_vertex_count > m_vertex_capacity || (int)m_indices.size() > m_index_capacity)
+        {
+            release();
+
+            const int vertex_capacity = m_vertex_count + m_vertex_count / 2;
+            const int index_capacity = (int)m_indices.size() + (int)m_indices.size() / 2;
+
+            m_vertex_buffer = al_create_vertex_buffer(NULL, NULL, vertex_capacity, ALLEGRO_PRIM_BUFFER_STREAM);
+            m_index_buffer = al_create_index_buffer(sizeof(int), NULL, index_capacity, ALLEGRO_PRIM_BUFFER_DYNAMIC);
+
+            if (!m_vertex_buffer || !m_index_buffer)
+            {
+                // memory bitmap target or a driver without buffer objects, stays that way for this display
+                DLOG(WARNING) << "[CircleBatch] vertex buffers unavailable, drawing from client memory";
+                release();
+                m_buffers_unsupported = true;
+                return false;
+            }
+
+            m_vertex_capacity = vertex_capacity;
+            m_index_capacity = index_capacity;
+        }
+
+        if (!m_indices_uploaded)
+        {
+            void *indices = al_lock_index_buffer(m_index_buffer, 0, (int)m_indices.size(), ALLEGRO_LOCK_WRITEONLY);
+            if (!indices)
+            {
+                return false;
+            }
+            memcpy(indices, m_indices.data(), m_indices.size() * sizeof(int));
+            al_unlock_index_buffer(m_index_buffer);
+            m_indices_uploaded = true;
+        }
+
+        return true;
+    }
+
+    void CircleBatch::writeVertices(const Circles &circles, ALLEGRO_VERTEX *out) const
+    {
+        const size_t count = circles.count;
+        const float *x = circles.x;
+        const float *y = circles.y;
+        const float *radius = circles.radius;
+        const ALLEGRO_COLOR *color = circles.color;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const UnitCircle &unit = m_lods[m_ball_lod[i]];
+            const size_t segments = unit.cos.size();
+            const float cx = x[i];
+            const float cy = y[i];
+            const float r = radius[i];
+
+            *out++ = {cx, cy, 0, 0, 0, color[i]};
+            for (size_t k = 0; k < segments; k++)
+            {
+                *out++ = {cx + r * unit.cos[k], cy + r * unit.sin[k], 0, 0, 0, color[i]};
+            }
+        }
+    }
+
+    void CircleBatch::draw(const Circles &circles)
+    {
+        if (circles.count == 0)
+        {
+            return;
+        }
+
+        if (circles.layout_version != m_layout_version)
+        {
+            rebuildLayout(circles);
+        }
+
+        if (ensureBuffers())
+        {
+            auto vertices = (ALLEGRO_VERTEX *)al_lock_vertex_buffer(m_vertex_buffer, 0, m_vertex_count, ALLEGRO_LOCK_WRITEONLY);
+            if (vertices)
+            {
+                writeVertices(circles, vertices);
+                al_unlock_vertex_buffer(m_vertex_buffer);
+
+                al_draw_indexed_buffer(m_vertex_buffer, NULL, m_index_buffer, 0, (int)m_indices.size(), ALLEGRO_PRIM_TRIANGLE_LIST);
+                return;
+            }
+        }
+
+        m_vertices.resize(m_vertex_count);
+        writeVertices(circles, m_vertices.data());
+        al_draw_indexed_prim(m_vertices.data(), NULL, NULL, m_indices.data(), (int)m_indices.size(), ALLEGRO_PRIM_TRIANGLE_LIST);
+    }
+}
@@ -0,0 +1,54 @@
+#include "Objects/UniformGrid.hpp"
+
+#include <cmath>
+
+namespace WUI
+{
+    // keeps a degenerate cell size (no balls, huge view) from producing millions of empty cells
+    static const size_t MAX_CELLS = 1 << 20;
+
+    void UniformGrid::build(const float *x, const float *y, size_t count, float cell_size, float width, float height)
+    {
+        m_cell_size = std::max(cell_size, 1.0f);
+        m_cols = std::max(1, (int)std::ceil(width / m_cell_size));
+        m_rows = std::max(1, (int)std::ceil(height / m_cell_size));
+        while ((size_t)m_cols * m_rows > MAX_CELLS)
+        {
+            m_cell_size *= 2;
+            m_cols = std::max(1, (int)std::ceil(width / m_cell_size));
+            m_rows = std::max(1, (int)std::ceil(height / m_cell_size));
+        }
+        m_inv_cell_size = 1 / m_cell_size;
+
+        const size_t cells = (size_t)m_cols * m_rows;
+        m_cell_start.assign(cells + 1, 0);
+        m_cell_of.resize(count);
+        m_order.resize(count);
+        m_position.resize(count);
+
+        // count, prefix sum, scatter. The scatter walks the points in order, so cells stay sorted by index.
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint32_t cell = (uint32_t)cellY(y[i]) * m_cols + cellX(x[i]);
+            m_cell_of[i] = cell;
+            m_cell_start[cell + 1]++;
+        }
+        for (size_t cell = 0; cell < cells; cell++)
+        {
+            m_cell_start[cell + 1] += m_cell_start[cell];
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint32_t position = m_cell_start[m_cell_of[i]]++;
+            m_order[position] = (uint32_t)i;
+            m_position[i] = position;
+        }
+
+        // the scatter advanced every start to the next cell's, shift them back
+        for (size_t cell = cells; cell > 0; cell--)
+        {
+            m_cell_start[cell] = m_cell_start[cell - 1];
+        }
+        m_cell_start[0] = 0;
+    }
+}
@@ -0,0 +1,69 @@
+#include "Render/DirtyRects.hpp"
+
+#include <algorithm>
+
+namespace WUI
+{
+    namespace DirtyRects
+    {
+        CefRect intersect(const CefRect &a, const CefRect &b)
+        {
+            const int x0 = std::max(a.x, b.x);
+            const int y0 = std::max(a.y, b.y);
+            const int x1 = std::min(a.x + a.width, b.x + b.width);
+            const int y1 = std::min(a.y + a.height, b.y + b.height);
+
+            if (x1 <= x0 || y1 <= y0)
+            {
+                return CefRect(0, 0, 0, 0);
+            }
+            return CefRect(x0, y0, x1 - x0, y1 - y0);
+        }
+
+        CefRect unite(const CefRect &a, const CefRect &b)
+        {
+            const int x0 = std::min(a.x, b.x);
+            const int y0 = std::min(a.y, b.y);
+            const int x1 = std::max(a.x + a.width, b.x + b.width);
+            const int y1 = std::max(a.y + a.height, b.y + b.height);
+
+            return CefRect(x0, y0, x1 - x0, y1 - y0);
+        }
+
+        bool touch(const CefRect &a, const CefRect &b, int slack)
+        {
+            return a.x - slack < b.x + b.width && b.x < a.x + a.width + slack &&
+                   a.y - slack < b.y + b.height && b.y < a.y + a.height + slack;
+        }
+
+        void merge(std::vector<CefRect> &rects, const CefRect &bounds, int slack)
+        {
+            for (auto &rect : rects)
+            {
+                rect = intersect(rect, bounds);
+            }
+            rects.erase(std::remove_if(rects.begin(), rects.end(), [](const CefRect &rect)
+                                       { return rect.width <= 0 || rect.height <= 0; }),
+                        rects.end());
+
+            bool merged = true;
+            while (merged)
+            {
+                merged = false;
+                for (size_t i = 0; i < rects.size() && !merged; i++)
+                {
+                    for (size_t j = i + 1; j < rects.size(); j++)
+                    {
+                        if (touch(rects[i], rects[j], slack))
+                        {
+                            rects[i] = unite(rects[i], rects[j]);
+                            rects.erase(rects.begin() + j);
+                            merged = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
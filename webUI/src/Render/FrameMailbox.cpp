@@ -0,0 +1,82 @@
+#include "Render/FrameMailbox.hpp"
+
+#include "Render/DirtyRects.hpp"
+#include "util/trace.hpp"
+
+#include <chrono>
+
+namespace WUI
+{
+    void FrameMailbox::publish(const void *buffer, int width, int height, std::vector<CefRect> damage, uint32_t marker)
+    {
+        StagingFrame &frame = m_frames.back();
+
+        // the slot keeps its buffer while the view fits, see ResizePolicy
+        const double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        frame.capacity.setPooled(m_pooled);
+        const bool reallocated = frame.capacity.fit(width, height, now);
+        if (reallocated)
+        {
+            const size_t old_bytes = frame.pixels.size();
+
+            // release first, the old contents are not copied over and both never have to exist at once
+            frame.pixels.clear();
+            frame.pixels.shrink_to_fit();
+            frame.pixels.resize(frame.capacity.capacityBytes());
+            frame.pitch = (ptrdiff_t)frame.capacity.capacityWidth() * 4;
+
+            m_staging_bytes += frame.pixels.size() - old_bytes;
+            m_reallocations++;
+        }
+        frame.width = width;
+        frame.height = height;
+
+        const CefRect bounds(0, 0, width, height);
+
+        // after a size change nothing the consumer holds is usable anymore, a fresh slot holds nothing at all
+        if (reallocated || width != m_last_width || height != m_last_height)
+        {
+            damage = {bounds};
+            m_last_width = width;
+            m_last_height = height;
+        }
+
+        // the previous frame may still be skipped, if the one before it already was its whole damage is still pending
+        const auto &pending = m_last_skipped ? m_last_damage : m_last_dirty;
+        std::vector<CefRect> dirty = damage;
+
+        damage.insert(damage.end(), pending.begin(), pending.end());
+        DirtyRects::merge(damage, bounds);
+        m_last_dirty = std::move(dirty);
+
+        const ptrdiff_t src_pitch = (ptrdiff_t)width * 4;
+        TRACE_SPAN("paint convert");
+        for (const auto &rect : damage)
+        {
+            m_convert(frame.pixels.data() + rect.y * frame.pitch + rect.x * 4, frame.pitch,
+                      (const uint8_t *)buffer + rect.y * src_pitch + rect.x * 4, src_pitch,
+                      rect.width, rect.height);
+        }
+
+        frame.damage = damage;
+        frame.sequence = ++m_sequence;
+        frame.marker = marker;
+        frame.epoch = m_epoch.load(std::memory_order_relaxed);
+        m_last_damage = std::move(damage);
+
+        m_last_skipped = m_frames.publish();
+        if (m_last_skipped)
+        {
+            m_skipped_frames++;
+        }
+    }
+
+    const StagingFrame *FrameMailbox::acquire()
+    {
+        if (!m_frames.take() || m_frames.front().epoch != epoch())
+        {
+            return nullptr;
+        }
+        return &m_frames.front();
+    }
+}
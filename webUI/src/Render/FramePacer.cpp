@@ -0,0 +1,46 @@
+#include "Render/FramePacer.hpp"
+
+#include <include/base/cef_logging.h>
+
+namespace WUI
+{
+    FramePacer::FramePacer(int engine_fps)
+        : m_engine_fps(engine_fps > 0 ? engine_fps : 60)
+    {
+    }
+
+    bool FramePacer::endFrame(double render_seconds)
+    {
+        const double paint_seconds = m_paint_cost_ns.exchange(0, std::memory_order_relaxed) / 1e9;
+        const double cost = render_seconds + paint_seconds;
+
+        m_frame_cost = m_frame_cost == 0 ? cost : m_frame_cost + EWMA_WEIGHT * (cost - m_frame_cost);
+        m_frame_index++;
+        m_frames_since_change++;
+
+        // give every change half a second to settle before judging it
+        if (m_frames_since_change < m_engine_fps / 2)
+        {
+            return false;
+        }
+
+        const int divisor = m_ui_divisor.load(std::memory_order_relaxed);
+        if (m_frame_cost > OVER_BUDGET * budget() && uiFps() > MIN_UI_FPS && m_engine_fps / (divisor + 1) >= MIN_UI_FPS)
+        {
+            m_ui_divisor.store(divisor + 1, std::memory_order_relaxed);
+        }
+        else if (m_frame_cost < UNDER_BUDGET * budget() && divisor > 1 && m_frames_since_change >= m_engine_fps)
+        {
+            m_ui_divisor.store(divisor - 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            return false;
+        }
+
+        m_frames_since_change = 0;
+        DLOG(INFO) << "[Pacer] frame cost " << m_frame_cost * 1000 << "ms of " << budget() * 1000
+                   << "ms budget, UI now at " << uiFps() << " fps";
+        return true;
+    }
+}
@@ -0,0 +1,28 @@
+#include "Render/FrameScheduler.hpp"
+
+namespace WUI
+{
+    FrameScheduler::FrameScheduler()
+    {
+        al_init_user_event_source(&m_event_source);
+    }
+
+    FrameScheduler::~FrameScheduler()
+    {
+        al_destroy_user_event_source(&m_event_source);
+    }
+
+    void FrameScheduler::invalidate(uint32_t sources)
+    {
+        // only the first damage after a consume needs to wake the render loop
+        if (m_damage.fetch_or(sources, std::memory_order_acq_rel) != DAMAGE_NONE)
+        {
+            return;
+        }
+
+        ALLEGRO_EVENT event = {};
+        event.user.type = WUI_EVENT_FRAME_DAMAGE;
+        event.user.data1 = (intptr_t)sources;
+        al_emit_user_event(&m_event_source, &event, nullptr);
+    }
+}
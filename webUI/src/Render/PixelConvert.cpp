@@ -0,0 +1,161 @@
+#include "Render/PixelConvert.hpp"
+
+#include <atomic>
+#include <cstring>
+
+#if WUI_X86
+#include <immintrin.h>
+#endif
+
+namespace WUI
+{
+    namespace PixelConvert
+    {
+        /*
+        B  -> A
+        G  -> R
+        R  -> G
+        A  -> B
+        */
+        static void rowScalar(uint8_t *dst, const uint8_t *src, size_t pixels)
+        {
+            for (size_t i = 0; i < pixels; i++)
+            {
+                dst[i * 4 + 0] = src[i * 4 + 3];
+                dst[i * 4 + 1] = src[i * 4 + 0];
+                dst[i * 4 + 2] = src[i * 4 + 1];
+                dst[i * 4 + 3] = src[i * 4 + 2];
+            }
+        }
+
+#if WUI_X86
+        WUI_TARGET("ssse3")
+        static void rowSSSE3(uint8_t *dst, const uint8_t *src, size_t pixels)
+        {
+            const __m128i mask = _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+            size_t i = 0;
+            for (; i + 16 <= pixels; i += 16)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(src + i * 4));
+                __m128i b = _mm_loadu_si128((const __m128i *)(src + i * 4 + 16));
+                __m128i c = _mm_loadu_si128((const __m128i *)(src + i * 4 + 32));
+                __m128i d = _mm_loadu_si128((const __m128i *)(src + i * 4 + 48));
+                _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(a, mask));
+                _mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_shuffle_epi8(b, mask));
+                _mm_storeu_si128((__m128i *)(dst + i * 4 + 32), _mm_shuffle_epi8(c, mask));
+                _mm_storeu_si128((__m128i *)(dst + i * 4 + 48), _mm_shuffle_epi8(d, mask));
+            }
+            for (; i + 4 <= pixels; i += 4)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(src + i * 4));
+                _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(a, mask));
+            }
+            rowScalar(dst + i * 4, src + i * 4, pixels - i);
+        }
+
+        WUI_TARGET("avx2")
+        static void rowAVX2(uint8_t *dst, const uint8_t *src, size_t pixels)
+        {
+            // vpshufb works per 128 bit lane, so the mask is just repeated
+            const __m256i mask = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                                  3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+
+            size_t i = 0;
+            for (; i + 32 <= pixels; i += 32)
+            {
+                __m256i a = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+                __m256i b = _mm256_loadu_si256((const __m256i *)(src + i * 4 + 32));
+                __m256i c = _mm256_loadu_si256((const __m256i *)(src + i * 4 + 64));
+                __m256i d = _mm256_loadu_si256((const __m256i *)(src + i * 4 + 96));
+                _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_shuffle_epi8(a, mask));
+                _mm256_storeu_si256((__m256i *)(dst + i * 4 + 32), _mm256_shuffle_epi8(b, mask));
+                _mm256_storeu_si256((__m256i *)(dst + i * 4 + 64), _mm256_shuffle_epi8(c, mask));
+                _mm256_storeu_si256((__m256i *)(dst + i * 4 + 96), _mm256_shuffle_epi8(d, mask));
+            }
+            for (; i + 8 <= pixels; i += 8)
+            {
+                __m256i a = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+                _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_shuffle_epi8(a, mask));
+            }
+            // remaining < 8 pixels, avoids a scalar tail of up to 7 pixels on every row
+            rowSSSE3(dst + i * 4, src + i * 4, pixels - i);
+        }
+#endif
+
+        RowKernel rowKernel(Isa isa)
+        {
+            switch (isa)
+            {
+            case Isa::Scalar:
+                return rowScalar;
+#if WUI_X86
+            case Isa::SSSE3:
+                return rowSSSE3;
+            case Isa::AVX2:
+                return rowAVX2;
+#endif
+            default:
+                return nullptr;
+            }
+        }
+
+        Isa activeIsa()
+        {
+            return bestIsa();
+        }
+
+        // nullptr until the first conversion, see g_best_isa in cpu_isa.cpp
+        static std::atomic<RowKernel> g_kernel{nullptr};
+
+        static RowKernel activeKernel()
+        {
+            RowKernel kernel = g_kernel.load(std::memory_order_relaxed);
+            if (!kernel)
+            {
+                kernel = rowKernel(activeIsa());
+                g_kernel.store(kernel, std::memory_order_relaxed);
+            }
+            return kernel;
+        }
+
+        void bgraToRgba(uint8_t *dst, ptrdiff_t dst_pitch,
+                        const uint8_t *src, ptrdiff_t src_pitch,
+                        int width, int height)
+        {
+            const RowKernel kernel = activeKernel();
+
+            // rows that are contiguous on both sides are converted as one long row
+            if (dst_pitch == src_pitch && src_pitch == (ptrdiff_t)width * 4)
+            {
+                kernel(dst, src, (size_t)width * height);
+                return;
+            }
+
+            for (int row = 0; row < height; row++)
+            {
+                kernel(dst, src, width);
+                dst += dst_pitch;
+                src += src_pitch;
+            }
+        }
+
+        void copy(uint8_t *dst, ptrdiff_t dst_pitch,
+                  const uint8_t *src, ptrdiff_t src_pitch,
+                  int width, int height)
+        {
+            if (dst_pitch == src_pitch && src_pitch == (ptrdiff_t)width * 4)
+            {
+                memcpy(dst, src, (size_t)width * height * 4);
+                return;
+            }
+
+            for (int row = 0; row < height; row++)
+            {
+                memcpy(dst, src, (size_t)width * 4);
+                dst += dst_pitch;
+                src += src_pitch;
+            }
+        }
+    }
+}
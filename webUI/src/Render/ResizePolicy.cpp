@@ -0,0 +1,72 @@
+#include "Render/ResizePolicy.hpp"
+
+#include <algorithm>
+
+namespace WUI
+{
+    static int withHeadroom(int size, int max_size)
+    {
+        const int wanted = (int)(size * ResizePolicy::HEADROOM);
+        const int aligned = (wanted + ResizePolicy::ALIGNMENT - 1) / ResizePolicy::ALIGNMENT * ResizePolicy::ALIGNMENT;
+        return max_size > 0 ? std::max(size, std::min(aligned, max_size)) : aligned;
+    }
+
+    bool ResizePolicy::fit(int width, int height, double now)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+
+        if (!m_pooled)
+        {
+            if (width == m_width && height == m_height)
+            {
+                return false;
+            }
+            m_width = width;
+            m_height = height;
+            m_reallocations++;
+            return true;
+        }
+
+        // only the dimension that ran out grows, a horizontal drag keeps the height
+        if (width > m_width || height > m_height)
+        {
+            if (width > m_width)
+            {
+                m_width = withHeadroom(width, m_max_size);
+            }
+            if (height > m_height)
+            {
+                m_height = withHeadroom(height, m_max_size);
+            }
+            m_oversized_since = -1;
+            m_reallocations++;
+            return true;
+        }
+
+        const bool oversized = (double)width * height < SHRINK_AREA * m_width * m_height;
+        if (!oversized)
+        {
+            m_oversized_since = -1;
+            return false;
+        }
+
+        if (m_oversized_since < 0)
+        {
+            m_oversized_since = now;
+            return false;
+        }
+
+        if (now - m_oversized_since < SHRINK_DELAY)
+        {
+            return false;
+        }
+
+        // shrunk with headroom the view covers 64% of it, well above SHRINK_AREA, no shrink / grow ping pong
+        m_width = std::min(m_width, withHeadroom(width, m_max_size));
+        m_height = std::min(m_height, withHeadroom(height, m_max_size));
+        m_oversized_since = -1;
+        m_reallocations++;
+        return true;
+    }
+}
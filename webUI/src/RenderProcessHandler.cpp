@@ -0,0 +1,334 @@
+#include "RenderProcessHandler.hpp"
+
+#include <include/base/cef_logging.h>
+#include <include/cef_task.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace WUI
+{
+    namespace
+    {
+        class FlushTask : public CefTask
+        {
+        private:
+            CefRefPtr<RenderProcessHandler> m_handler;
+
+        public:
+            explicit FlushTask(CefRefPtr<RenderProcessHandler> handler)
+                : m_handler(handler)
+            {
+            }
+
+            virtual void Execute() override
+            {
+                m_handler->flush();
+            }
+
+            IMPLEMENT_REFCOUNTING(FlushTask);
+        };
+
+        // frees the page's copy of a snapshot once V8 collected the ArrayBuffer
+        class CopyRelease : public CefV8ArrayBufferReleaseCallback
+        {
+        public:
+            virtual void ReleaseBuffer(void *buffer) override
+            {
+                free(buffer);
+            }
+
+            IMPLEMENT_REFCOUNTING(CopyRelease);
+        };
+
+        CefRefPtr<CefV8Value> toV8(const Bus::Value &value)
+        {
+            switch (value.type)
+            {
+            case Bus::Value::Type::Bool:
+                return CefV8Value::CreateBool(value.number != 0);
+            case Bus::Value::Type::Number:
+                return CefV8Value::CreateDouble(value.number);
+            case Bus::Value::Type::String:
+                return CefV8Value::CreateString(value.string);
+            default:
+                return CefV8Value::CreateNull();
+            }
+        }
+
+        // false for objects and functions, the bus carries plain values only
+        bool fromV8(CefRefPtr<CefV8Value> value, Bus::Value &out)
+        {
+            if (!value || value->IsNull() || value->IsUndefined())
+            {
+                out = Bus::Value();
+            }
+            else if (value->IsBool())
+            {
+                out = Bus::Value::boolean(value->GetBoolValue());
+            }
+            else if (value->IsInt() || value->IsUInt() || value->IsDouble())
+            {
+                out = Bus::Value::of(value->GetDoubleValue());
+            }
+            else if (value->IsString())
+            {
+                out = Bus::Value::of(value->GetStringValue().ToString());
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+        }
+    }
+
+    void RenderProcessHandler::OnContextCreated(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context)
+    {
+        if (!frame->IsMain())
+        {
+            return;
+        }
+
+        m_context = context;
+        m_subscribers.clear();
+
+        CefRefPtr<CefV8Value> wui = CefV8Value::CreateObject(nullptr, nullptr);
+        for (const char *name : {"subscribe", "unsubscribe", "publish", "data"})
+        {
+            wui->SetValue(name, CefV8Value::CreateFunction(name, this), V8_PROPERTY_ATTRIBUTE_READONLY);
+        }
+        context->GetGlobal()->SetValue("wui", wui, V8_PROPERTY_ATTRIBUTE_READONLY);
+    }
+
+    void RenderProcessHandler::OnContextReleased(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefRefPtr<CefV8Context> context)
+    {
+        if (m_context && m_context->IsSame(context))
+        {
+            // the functions die with the page, the state stays for the next one
+            flush();
+            m_subscribers.clear();
+            for (auto &data : m_data)
+            {
+                data.second.object = nullptr;
+            }
+            m_context = nullptr;
+        }
+    }
+
+    bool RenderProcessHandler::Execute(const CefString &name, CefRefPtr<CefV8Value> object, const CefV8ValueList &arguments, CefRefPtr<CefV8Value> &retval, CefString &exception)
+    {
+        const std::string function = name.ToString();
+
+        if (function == "subscribe")
+        {
+            if (arguments.size() < 2 || !arguments[0]->IsString() || !arguments[1]->IsFunction())
+            {
+                exception = "wui.subscribe(topic, callback)";
+                return true;
+            }
+
+            const std::string topic = arguments[0]->GetStringValue().ToString();
+            const uint32_t id = m_next_subscription++;
+            m_subscribers[topic].emplace_back(id, arguments[1]);
+            retval = CefV8Value::CreateUInt(id);
+
+            auto state = m_state.find(topic);
+            if (state != m_state.end())
+            {
+                arguments[1]->ExecuteFunction(nullptr, {toV8(state->second)});
+            }
+            return true;
+        }
+
+        if (function == "unsubscribe")
+        {
+            if (arguments.empty() || !(arguments[0]->IsUInt() || arguments[0]->IsInt()))
+            {
+                exception = "wui.unsubscribe(id)";
+                return true;
+            }
+
+            const uint32_t id = arguments[0]->GetUIntValue();
+            for (auto &topic : m_subscribers)
+            {
+                auto &handlers = topic.second;
+                handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [id](const auto &handler)
+                                              { return handler.first == id; }),
+                               handlers.end());
+            }
+            return true;
+        }
+
+        if (function == "publish")
+        {
+            Bus::Value value;
+            if (arguments.empty() || !arguments[0]->IsString() || !fromV8(arguments.size() > 1 ? arguments[1] : nullptr, value))
+            {
+                exception = "wui.publish(topic, null | boolean | number | string)";
+                return true;
+            }
+
+            m_outgoing.add(arguments[0]->GetStringValue().ToString(), value);
+            if (!m_flush_scheduled)
+            {
+                m_flush_scheduled = true;
+                CefPostTask(TID_RENDERER, new FlushTask(this));
+            }
+            return true;
+        }
+
+        if (function == "data")
+        {
+            if (arguments.empty() || !arguments[0]->IsString())
+            {
+                exception = "wui.data(channel)";
+                return true;
+            }
+
+            auto data = m_data.find(arguments[0]->GetStringValue().ToString());
+            retval = data != m_data.end() ? dataObject(data->second) : CefV8Value::CreateNull();
+            return true;
+        }
+
+        return false;
+    }
+
+    CefRefPtr<CefV8Value> RenderProcessHandler::dataObject(DataSnapshot &snapshot)
+    {
+        // the same object until the next generation, polling every frame allocates nothing
+        if (!snapshot.object)
+        {
+            const Bus::DataHeader &header = snapshot.header;
+            const size_t bytes = header.count * Bus::dataTypeSize(header.type);
+
+            // the region is mapped read only, a page writing into an ArrayBuffer on top of it would crash the
+            // renderer. The page gets its own copy, made once per generation.
+            void *data = malloc(std::max<size_t>(bytes, 1));
+            if (!data)
+            {
+                return CefV8Value::CreateNull();
+            }
+            memcpy(data, (const uint8_t *)snapshot.region->Memory() + header.data_offset, bytes);
+
+            snapshot.object = CefV8Value::CreateObject(nullptr, nullptr);
+            snapshot.object->SetValue("generation", CefV8Value::CreateDouble((double)header.generation), V8_PROPERTY_ATTRIBUTE_READONLY);
+            snapshot.object->SetValue("type", CefV8Value::CreateString(Bus::dataTypeName(header.type)), V8_PROPERTY_ATTRIBUTE_READONLY);
+            snapshot.object->SetValue("count", CefV8Value::CreateDouble((double)header.count), V8_PROPERTY_ATTRIBUTE_READONLY);
+            snapshot.object->SetValue("buffer",
+                                      CefV8Value::CreateArrayBuffer(data, bytes, new CopyRelease()),
+                                      V8_PROPERTY_ATTRIBUTE_READONLY);
+        }
+        return snapshot.object;
+    }
+
+    void RenderProcessHandler::receiveData(CefRefPtr<CefProcessMessage> message)
+    {
+        CefRefPtr<CefSharedMemoryRegion> region = message->GetSharedMemoryRegion();
+        if (!region || !region->IsValid())
+        {
+            return;
+        }
+
+        Bus::DataHeader header;
+        std::string name;
+        if (!Bus::readDataHeader(region->Memory(), region->Size(), header, name))
+        {
+            DLOG(WARNING) << "[Data] malformed snapshot from the engine";
+            return;
+        }
+
+        // generations only grow, anything else is stale
+        DataSnapshot &snapshot = m_data[name];
+        if (snapshot.region && snapshot.header.generation >= header.generation)
+        {
+            return;
+        }
+
+        // buffers already handed to JS are copies, the old region can go
+        snapshot.region = region;
+        snapshot.header = header;
+        snapshot.object = nullptr;
+    }
+
+    void RenderProcessHandler::flush()
+    {
+        m_flush_scheduled = false;
+        if (m_outgoing.empty() || !m_context)
+        {
+            m_outgoing.clear();
+            return;
+        }
+
+        CefRefPtr<CefProcessMessage> message = CefProcessMessage::Create(Bus::MESSAGE_NAME);
+        message->GetArgumentList()->SetBinary(0, CefBinaryValue::Create(m_outgoing.bytes().data(), m_outgoing.bytes().size()));
+        m_outgoing.clear();
+
+        m_context->GetFrame()->SendProcessMessage(PID_BROWSER, message);
+    }
+
+    bool RenderProcessHandler::OnProcessMessageReceived(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, CefProcessId source_process, CefRefPtr<CefProcessMessage> message)
+    {
+        if (message->GetName().ToString() == Bus::DATA_MESSAGE_NAME)
+        {
+            receiveData(message);
+            return true;
+        }
+
+        if (message->GetName().ToString() != Bus::MESSAGE_NAME)
+        {
+            return false;
+        }
+
+        CefRefPtr<CefBinaryValue> batch = message->GetArgumentList()->GetBinary(0);
+        if (!batch)
+        {
+            return true;
+        }
+
+        // one context entry for the whole batch instead of one per callback
+        const bool entered = m_context && m_context->Enter();
+
+        const bool ok = Bus::decode((const uint8_t *)batch->GetRawData(), batch->GetSize(),
+                                    [&](const std::string &topic, const Bus::Value &value, uint8_t flags)
+                                    {
+                                        if (flags & Bus::FLAG_STATE)
+                                        {
+                                            m_state[topic] = value;
+                                        }
+                                        if (entered)
+                                        {
+                                            deliver(topic, value);
+                                        }
+                                    });
+
+        if (entered)
+        {
+            m_context->Exit();
+        }
+
+        if (!ok)
+        {
+            DLOG(WARNING) << "[Bus] malformed batch from the engine";
+        }
+        return true;
+    }
+
+    void RenderProcessHandler::deliver(const std::string &topic, const Bus::Value &value)
+    {
+        auto subscribers = m_subscribers.find(topic);
+        if (subscribers == m_subscribers.end() || subscribers->second.empty())
+        {
+            return;
+        }
+
+        // callbacks may subscribe or unsubscribe, iterate a copy
+        const auto handlers = subscribers->second;
+        const CefV8ValueList arguments = {toV8(value)};
+        for (const auto &handler : handlers)
+        {
+            handler.second->ExecuteFunction(nullptr, arguments);
+        }
+    }
+}
@@ -1,14 +1,32 @@
 #include "RenderHandler.hpp"
+#include "BrowserApp.hpp"
+#include "Render/DirtyRects.hpp"
+#include "Render/PixelConvert.hpp"
+#include "util/startup_report.hpp"
+#include "util/task_scheduler.hpp"
+#include "util/trace.hpp"
 
 #include <allegro5/allegro_primitives.h>
+
+#include <algorithm>
+#include <vector>
+
 namespace WUI
 {
 
-#define FULL_REDRAW 1
+// upload the whole frame on every paint instead of only the dirty rects
+#define FULL_REDRAW 0
+
+    // balls interpolated per parallel chunk
+    static const size_t INTERPOLATE_GRAIN = 8192;
 
-    RenderHandler::RenderHandler(const int &FPS,
-                                 const int &width,
-                                 const int &height)
+    RenderHandler::RenderHandler(const RenderSettings &settings)
+        : m_frame_pacer(settings.fps),
+          m_view_width(settings.width),
+          m_view_height(settings.height),
+          m_osr_capacity(settings.pooled_resize),
+          m_popup_capacity(settings.pooled_resize),
+          m_simulation(m_frame_scheduler, settings.width, settings.height)
     {
         if (!al_is_system_installed())
         {
@@ -18,24 +36,53 @@ namespace WUI
             al_init_primitives_addon();
         }
 
-        m_display = al_create_display(width, height);
+        if (settings.headless)
+        {
+            // everything is drawn into a memory bitmap, works without a display server or gpu
+            const int old_flags = al_get_new_bitmap_flags();
+            al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+            m_headless_target = al_create_bitmap(settings.width, settings.height);
+            al_set_new_bitmap_flags(old_flags);
 
-        al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP); // use memory bitmap for OSR buffer
+            if (m_headless_target)
+            {
+                al_set_target_bitmap(m_headless_target);
+            }
+        }
+        else
+        {
+            // with vsync al_flip_display waits for the vertical blank, 1 = on, 2 = off
+            al_set_new_display_option(ALLEGRO_VSYNC, settings.vsync ? 1 : 2, ALLEGRO_SUGGEST);
 
-        m_osr_buffer = al_create_bitmap(BASE_WIDTH, BASE_HEIGHT);
+            const int old_flags = al_get_new_display_flags();
+            if (settings.resizable)
+            {
+                al_set_new_display_flags(old_flags | ALLEGRO_RESIZABLE);
+            }
+            m_display = al_create_display(settings.width, settings.height);
+            al_set_new_display_flags(old_flags);
+        }
+
+        // the OSR bitmap starts out with headroom, the first resizes fit into it. Video bitmaps have a size limit,
+        // a memory bitmap as the headless target has none.
+        if (m_display)
+        {
+            const int max_size = al_get_display_option(m_display, ALLEGRO_MAX_BITMAP_SIZE);
+            m_osr_capacity.setMaxSize(max_size);
+            m_popup_capacity.setMaxSize(max_size);
+        }
+        m_osr_capacity.fit(settings.width, settings.height, al_get_time());
+        m_frame_mailbox.setPooled(settings.pooled_resize);
+        m_popup_mailbox.setPooled(settings.pooled_resize);
 
-        if (!m_display || !m_osr_buffer)
+        if ((!m_display && !m_headless_target) ||
+            !createOsrBuffer(m_osr_capacity.capacityWidth(), m_osr_capacity.capacityHeight(), settings.native_osr_format))
         {
             DLOG(FATAL) << "Failed to create display or OSR bitmap buffer";
             exit(1);
         }
 
-        // clear entire bitmap to white
-        auto locked_region = al_lock_bitmap(m_osr_buffer, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_WRITEONLY);
-        memset(locked_region->data, 0, width * height * locked_region->pixel_size);
-        al_unlock_bitmap(m_osr_buffer);
-
-        m_timer = al_create_timer(1.0 / FPS);
+        m_timer = al_create_timer(m_frame_pacer.budget());
         if (!m_timer)
         {
             DLOG(FATAL) << "Failed to create timer.";
@@ -51,39 +98,296 @@ namespace WUI
         }
 
         // Register event sources
-        al_register_event_source(m_event_queue, al_get_display_event_source(m_display));
+        if (m_display)
+        {
+            al_register_event_source(m_event_queue, al_get_display_event_source(m_display));
+        }
         al_register_event_source(m_event_queue, al_get_timer_event_source(m_timer));
+        al_register_event_source(m_event_queue, m_frame_scheduler.getEventSource());
+
+        if (m_display && settings.vsync && al_get_display_option(m_display, ALLEGRO_VSYNC) != 1)
+        {
+            DLOG(WARNING) << "[Renderer] vsync requested but not available";
+        }
 
         // Display a black screen, clear the screen once
         al_clear_to_color(al_map_rgb(0, 0, 0));
-        al_flip_display();
+        if (m_display)
+        {
+            al_flip_display();
+        }
 
         m_background_color = CefColorSetARGB(255, 255, 0, 0);
+
+        m_simulation.start();
+    }
+
+    bool RenderHandler::createOsrBuffer(int width, int height, bool allow_native)
+    {
+        struct Candidate
+        {
+            int flags;
+            int format;
+            OsrUploadMode mode;
+        };
+
+        // CEF paints BGRA bytes, allegro calls that ARGB_8888 on little endian machines.
+        // Video bitmaps are preferred even when they need the swizzle, drawing a memory bitmap is done in software.
+        const Candidate candidates[] = {
+#ifdef ALLEGRO_LITTLE_ENDIAN
+            {ALLEGRO_VIDEO_BITMAP, ALLEGRO_PIXEL_FORMAT_ARGB_8888, OsrUploadMode::Native},
+#endif
+            {ALLEGRO_VIDEO_BITMAP, ALLEGRO_PIXEL_FORMAT_RGBA_8888, OsrUploadMode::Converting},
+#ifdef ALLEGRO_LITTLE_ENDIAN
+            {ALLEGRO_MEMORY_BITMAP, ALLEGRO_PIXEL_FORMAT_ARGB_8888, OsrUploadMode::Native},
+#endif
+            {ALLEGRO_MEMORY_BITMAP, ALLEGRO_PIXEL_FORMAT_RGBA_8888, OsrUploadMode::Converting},
+        };
+
+        const int old_flags = al_get_new_bitmap_flags();
+        const int old_format = al_get_new_bitmap_format();
+
+        ALLEGRO_BITMAP *bitmap = NULL;
+        for (const auto &candidate : candidates)
+        {
+            if (candidate.mode == OsrUploadMode::Native && !allow_native)
+            {
+                continue;
+            }
+
+            al_set_new_bitmap_flags(candidate.flags);
+            al_set_new_bitmap_format(candidate.format);
+
+            bitmap = al_create_bitmap(width, height);
+
+            // allegro silently picks another format if the display does not support the requested one
+            if (bitmap && al_get_bitmap_format(bitmap) == candidate.format)
+            {
+                m_osr_format = candidate.format;
+                m_osr_mode = candidate.mode;
+                break;
+            }
+
+            if (bitmap)
+            {
+                al_destroy_bitmap(bitmap);
+                bitmap = NULL;
+            }
+        }
+
+        al_set_new_bitmap_flags(old_flags);
+        al_set_new_bitmap_format(old_format);
+
+        if (!bitmap)
+        {
+            return false;
+        }
+
+        // clear entire bitmap to transparent
+        auto locked_region = al_lock_bitmap(bitmap, m_osr_format, ALLEGRO_LOCK_WRITEONLY);
+        if (!locked_region)
+        {
+            al_destroy_bitmap(bitmap);
+            return false;
+        }
+        for (int row = 0; row < height; row++)
+        {
+            memset((uint8_t *)locked_region->data + row * locked_region->pitch, 0, (size_t)width * locked_region->pixel_size);
+        }
+        al_unlock_bitmap(bitmap);
+
+        m_osr_buffer = bitmap;
+        m_frame_mailbox.setConversion(m_osr_mode == OsrUploadMode::Native ? PixelConvert::copy : PixelConvert::bgraToRgba);
+        m_popup_mailbox.setConversion(m_osr_mode == OsrUploadMode::Native ? PixelConvert::copy : PixelConvert::bgraToRgba);
+
+        if (m_osr_mode == OsrUploadMode::Native)
+        {
+            DLOG(INFO) << "[Renderer] OSR upload mode: native ARGB_8888 "
+                       << ((al_get_bitmap_flags(bitmap) & ALLEGRO_MEMORY_BITMAP) ? "memory" : "video") << " bitmap, row copies";
+        }
+        else
+        {
+            DLOG(INFO) << "[Renderer] OSR upload mode: converting BGRA -> RGBA_8888 ("
+                       << isaName(PixelConvert::activeIsa()) << ") "
+                       << ((al_get_bitmap_flags(bitmap) & ALLEGRO_MEMORY_BITMAP) ? "memory" : "video") << " bitmap";
+        }
+
+        return true;
+    }
+
+    bool RenderHandler::reallocateBitmap(ALLEGRO_BITMAP *&bitmap, const ResizePolicy &capacity, int &keep_width, int &keep_height)
+    {
+        TRACE_SPAN("OSR realloc");
+
+        const int width = capacity.capacityWidth();
+        const int height = capacity.capacityHeight();
+
+        // same kind of bitmap as the OSR bitmap, the upload mode and the staging layout stay valid
+        ALLEGRO_STATE state;
+        al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS | ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_BLENDER);
+        al_set_new_bitmap_flags(al_get_bitmap_flags(m_osr_buffer));
+        al_set_new_bitmap_format(m_osr_format);
+
+        ALLEGRO_BITMAP *resized = al_create_bitmap(width, height);
+        if (!resized)
+        {
+            al_restore_state(&state);
+            DLOG(ERROR) << "[Renderer] failed to resize an OSR bitmap to " << width << "x" << height;
+            return false;
+        }
+
+        // keep showing the current contents until CEF painted the new size, copied as is including alpha
+        keep_width = bitmap ? std::min(keep_width, width) : 0;
+        keep_height = bitmap ? std::min(keep_height, height) : 0;
+        al_set_target_bitmap(resized);
+        al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+        al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+        if (keep_width > 0 && keep_height > 0)
+        {
+            al_draw_bitmap_region(bitmap, 0, 0, keep_width, keep_height, 0, 0, 0);
+        }
+        al_restore_state(&state);
+
+        if (bitmap)
+        {
+            al_destroy_bitmap(bitmap);
+        }
+        bitmap = resized;
+        return true;
+    }
+
+    bool RenderHandler::fitBitmap(ALLEGRO_BITMAP *&bitmap, ResizePolicy &capacity, int width, int height, int &keep_width, int &keep_height)
+    {
+        if (!capacity.fit(width, height, al_get_time()) || reallocateBitmap(bitmap, capacity, keep_width, keep_height))
+        {
+            return true;
+        }
+
+        // the headroom may be what does not fit, near the bitmap size limit or out of video memory
+        capacity.setCapacity(width, height);
+        if (reallocateBitmap(bitmap, capacity, keep_width, keep_height))
+        {
+            return true;
+        }
+
+        // the next fit() tries again, until then `bitmap` stays as it is
+        const int bitmap_width = bitmap ? al_get_bitmap_width(bitmap) : 0;
+        const int bitmap_height = bitmap ? al_get_bitmap_height(bitmap) : 0;
+        capacity.setCapacity(bitmap_width, bitmap_height);
+        return width <= bitmap_width && height <= bitmap_height;
     }
 
     RenderHandler::~RenderHandler()
     {
-        al_destroy_display(m_display);
-        al_destroy_event_queue(m_event_queue);
+        // renderLoop already tears everything down when it ran
+        m_simulation.stop();
+        m_ball_batch.release();
+        if (m_timer)
+        {
+            al_destroy_timer(m_timer);
+        }
+        if (m_osr_buffer)
+        {
+            al_destroy_bitmap(m_osr_buffer);
+        }
+        if (m_popup_buffer)
+        {
+            al_destroy_bitmap(m_popup_buffer);
+        }
+        if (m_headless_target)
+        {
+            al_destroy_bitmap(m_headless_target);
+        }
+        if (m_display)
+        {
+            al_destroy_display(m_display);
+        }
+        if (m_event_queue)
+        {
+            al_destroy_event_queue(m_event_queue);
+        }
+    }
+
+    int RenderHandler::getViewWidth() const
+    {
+        return m_view_width.load(std::memory_order_relaxed);
+    }
+
+    int RenderHandler::getViewHeight() const
+    {
+        return m_view_height.load(std::memory_order_relaxed);
+    }
+
+    void RenderHandler::resizeView(int width, int height)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (width == getViewWidth() && height == getViewHeight())
+        {
+            return;
+        }
+
+        m_view_width = width;
+        m_view_height = height;
+        m_resizes++;
+
+        // CEF asks GetViewRect again and paints the new size, until then its frames are stale
+        if (m_browser_host)
+        {
+            m_browser_host->WasResized();
+        }
+        m_frame_scheduler.invalidate(DAMAGE_RESIZE);
+    }
+
+    ResizeStats RenderHandler::getResizeStats() const
+    {
+        ResizeStats stats;
+        stats.resizes = m_resizes;
+        stats.osr_reallocations = m_osr_capacity.reallocations();
+        stats.staging_reallocations = m_frame_mailbox.reallocations();
+        stats.stale_frames = m_stale_frames;
+        stats.osr_bytes = m_osr_capacity.capacityBytes();
+        stats.staging_bytes = m_frame_mailbox.stagingBytes();
+        return stats;
     }
 
     void RenderHandler::renderLoop()
     {
-        // Start the timer
-        al_start_timer(m_timer);
         m_running = true;
 
+        // the display may have been created on another thread while CEF was starting, see main
+        if (m_display)
+        {
+            al_set_target_backbuffer(m_display);
+        }
+
+        // with the external pump CEF's UI thread work runs here as well
+        Trace::setThreadName("render / CEF UI");
+
+        // pump once right away, requests made before the pump source was attached are lost
+        m_pump_deadline = 0;
+
+        // the first frame is presented right away, after that the timer only runs while something changes
+        m_redraw_pending = true;
+        m_last_frame_time = std::chrono::steady_clock::now();
+
         // Game loop
         while (m_running)
         {
             ALLEGRO_EVENT event;
-            ALLEGRO_TIMEOUT timeout;
-
-            // Initialize timeout
-            al_init_timeout(&timeout, 0.06);
+            bool get_event = true;
 
-            // Fetch the event (if one exists)
-            bool get_event = al_wait_for_event_until(m_event_queue, &event, &timeout);
+            // sleep until the next event, or until scheduled CEF work is due
+            if (m_pump_deadline != NO_PUMP_SCHEDULED)
+            {
+                ALLEGRO_TIMEOUT timeout;
+                al_init_timeout(&timeout, std::max(0.0, m_pump_deadline - al_get_time()));
+                get_event = al_wait_for_event_until(m_event_queue, &event, &timeout);
+            }
+            else
+            {
+                al_wait_for_event(m_event_queue, &event);
+            }
 
             // Handle the event
             if (get_event)
@@ -93,9 +397,28 @@ namespace WUI
                 case ALLEGRO_EVENT_TIMER:
                     m_redraw_pending = true;
                     break;
+                case WUI_EVENT_FRAME_DAMAGE:
+                    // coming out of idle, present right away instead of waiting a full tick
+                    if (!al_get_timer_started(m_timer))
+                    {
+                        m_redraw_pending = true;
+                    }
+                    break;
+                case ALLEGRO_EVENT_DISPLAY_EXPOSE:
+                case ALLEGRO_EVENT_DISPLAY_SWITCH_IN:
+                    m_frame_scheduler.invalidate(DAMAGE_EXPOSE);
+                    break;
+                case ALLEGRO_EVENT_DISPLAY_RESIZE:
+                    // a drag sends a stream of these, each is cheap, buffers are only resized when drawing
+                    al_acknowledge_resize(m_display);
+                    resizeView(al_get_display_width(m_display), al_get_display_height(m_display));
+                    break;
                 case ALLEGRO_EVENT_DISPLAY_CLOSE:
                     m_running = false;
                     break;
+                case WUI_EVENT_PUMP_WORK:
+                    schedulePumpWork(event.user.data1);
+                    break;
                 default:
                     DLOG(INFO) << "Unsupported event received: " << event.type;
                     break;
@@ -105,131 +428,373 @@ namespace WUI
             // Check if we need to redraw
             if (m_redraw_pending && al_is_event_queue_empty(m_event_queue))
             {
-                if (IsTransparent())
+                m_redraw_pending = false;
+
+                const uint32_t damage = m_frame_scheduler.consume();
+                if (damage == DAMAGE_NONE && !m_animating)
                 {
-                    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+                    // static scene, no more ticks until something invalidates the frame again
+                    al_stop_timer(m_timer);
                 }
                 else
                 {
-                    al_clear_to_color(al_map_rgba(CefColorGetR(m_background_color),
-                                                  CefColorGetG(m_background_color),
-                                                  CefColorGetB(m_background_color),
-                                                  255));
+                    auto now = std::chrono::steady_clock::now();
+                    double delta_s = std::chrono::duration<double>(now - m_last_frame_time).count();
+                    m_last_frame_time = now;
+
+                    if (!al_get_timer_started(m_timer))
+                    {
+                        // nothing moved while idle, don't let the idle time leak into the simulation
+                        delta_s = 0;
+                        al_start_timer(m_timer);
+                    }
+
+                    renderFrame(delta_s);
+
+                    // flip is not frame work, with vsync it is mostly waiting
+                    const auto &timings = m_frame_timings;
+                    if (m_frame_pacer.endFrame(timings.renderables + timings.upload + timings.draw_ui))
+                    {
+                        applyFrameRates();
+                    }
                 }
+            }
 
-                // Redraw
+            // only run CEF when it asked for it
+            if (m_pump_deadline != NO_PUMP_SCHEDULED && al_get_time() >= m_pump_deadline)
+            {
+                m_pump_deadline = NO_PUMP_SCHEDULED;
 
-                static double delta_s = 0;
+                TRACE_SPAN("CefDoMessageLoopWork");
+                CefDoMessageLoopWork();
+            }
+        }
 
+        // teardown, gpu buffers first, they belong to the display
+        m_simulation.stop();
+        m_ball_batch.release();
+        al_destroy_timer(m_timer);
+        al_destroy_display(m_display);
+        al_destroy_bitmap(m_osr_buffer);
+        if (m_popup_buffer)
+        {
+            al_destroy_bitmap(m_popup_buffer);
+        }
+        al_destroy_event_queue(m_event_queue);
+        m_timer = NULL;
+        m_display = NULL;
+        m_osr_buffer = NULL;
+        m_popup_buffer = NULL;
+        m_event_queue = NULL;
+    }
+
+    // seconds since `start`, moves `start` to now. The stage is traced from the same timestamps.
+    static double lap(std::chrono::steady_clock::time_point &start, const char *stage)
+    {
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - start).count();
+
+#if WUI_TRACING
+        if (Trace::enabled())
+        {
+            using std::chrono::nanoseconds;
+            Trace::record(stage,
+                          std::chrono::duration_cast<nanoseconds>(start.time_since_epoch()).count(),
+                          std::chrono::duration_cast<nanoseconds>(now.time_since_epoch()).count());
+        }
+#endif
+
+        start = now;
+        return seconds;
+    }
+
+    void RenderHandler::renderFrame(double delta_s)
+    {
+        TRACE_SPAN("frame");
+
+        FrameTimings timings;
+        auto stage_start = std::chrono::steady_clock::now();
+
+        if (IsTransparent())
+        {
+            al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+        }
+        else
+        {
+            al_clear_to_color(al_map_rgba(CefColorGetR(m_background_color),
+                                          CefColorGetG(m_background_color),
+                                          CefColorGetB(m_background_color),
+                                          255));
+        }
+
+        // Redraw
+
+        bool animating = false;
+        const int view_width = getViewWidth();
+        const int view_height = getViewHeight();
+
+        applyRenderableCommands();
+        TaskScheduler::instance().parallelFor(m_renderables.size(), 1, [&](size_t begin, size_t end)
+                                              {
+            for (size_t i = begin; i < end; i++)
+            {
+                m_renderables[i]->update(view_width, view_height, delta_s);
+            } });
+
+        // draw submission stays on this thread
+        for (auto &renderable : m_renderables)
+        {
+            renderable->render(view_width, view_height, delta_s);
+            animating |= renderable->isAnimating();
+        }
+
+        // the simulation ticks on its own, draw its newest state moved on to the present
+        m_simulation.setBounds(view_width, view_height);
+        if (const BallSnapshot *balls = m_simulation.latest())
+        {
+            const double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            const double alpha = 1 + (now - balls->time) / BallSimulation::TICK_SECONDS;
+
+            m_ball_x.resize(balls->size());
+            m_ball_y.resize(balls->size());
+            const float t = (float)std::min(std::max(alpha, 0.0), 1.0);
+            TaskScheduler::instance().parallelFor(balls->size(), TaskScheduler::alignedGrain<float>(INTERPOLATE_GRAIN),
+                                                  [&](size_t begin, size_t end)
+                                                  { balls->interpolate(t, begin, end, m_ball_x.data(), m_ball_y.data()); });
+
+            m_ball_batch.draw(balls->circles(m_ball_x.data(), m_ball_y.data()));
+            animating |= balls->size() > 0;
+        }
+
+        m_animating = animating;
+        timings.renderables = lap(stage_start, "renderables");
+
+        // draw UI, always the newest complete frame CEF has painted.
+        // Over budget the pacer spreads UI uploads out, but only while the scene keeps redrawing anyway
+        // otherwise the frame would never be picked up.
+
+        // grows (or late shrinks) only, most steps of a resize drag fit into the bitmap as it is
+        const bool ui_fits = fitBitmap(m_osr_buffer, m_osr_capacity, view_width, view_height, m_ui_width, m_ui_height);
+
+        if (!animating || m_frame_pacer.shouldUploadUi())
+        {
+            if (auto frame = m_frame_mailbox.acquire())
+            {
+                if (frame->width != view_width || frame->height != view_height || !ui_fits)
                 {
-                    static auto last_delta_time_point = std::chrono::high_resolution_clock::now();
-                    auto end = std::chrono::high_resolution_clock::now();
-                    delta_s = std::chrono::duration<double, std::milli>(end - last_delta_time_point).count() / 1000; // why is chrono like this -.-
-                    last_delta_time_point = end;
+                    // painted before CEF saw the last resize or too big for the bitmap, the previous UI frame stays up
+                    // until the new size arrives. Its damage is lost, a full repaint keeps later partial frames of that
+                    // size from building on it.
+                    m_stale_frames++;
+                    m_ui_repaint = true;
                 }
-
-                m_l_renderables.lock();
-                for (auto &renderable : m_renderables)
+                else
                 {
-                    renderable->render(al_get_display_width(m_display),
-                                       al_get_display_height(m_display), delta_s);
+                    timings.upload_bytes = uploadFrame(m_osr_buffer, *frame);
+                    m_ui_marker = frame->marker;
+                    m_ui_shown = true;
+                    m_ui_width = frame->width;
+                    m_ui_height = frame->height;
                 }
-                m_l_renderables.unlock();
-
-                // draw UI
+            }
 
-                if (m_l_osr_buffer_lock.try_lock())
+            // the popup has its own small buffer, opening or hovering a dropdown uploads only its pixels
+            if (auto popup = m_popup_mailbox.acquire())
+            {
+                if (fitBitmap(m_popup_buffer, m_popup_capacity, popup->width, popup->height, m_popup_width, m_popup_height))
                 {
-                    // al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
-                    al_draw_bitmap(m_osr_buffer, 0, 0, 0);
-                    m_l_osr_buffer_lock.unlock();
+                    timings.upload_bytes += uploadFrame(m_popup_buffer, *popup);
+                    m_popup_width = popup->width;
+                    m_popup_height = popup->height;
+                    m_popup_epoch = popup->epoch;
                 }
                 else
                 {
-                    DLOG(WARNING) << "OSR buffer locked, skipping redraw";
+                    m_popup_epoch = 0; // nothing of this popup is shown
                 }
-
-                al_flip_display();
-                m_redraw_pending = false;
             }
-            CefDoMessageLoopWork();
         }
 
-        // teardown
-        al_destroy_timer(m_timer);
-        al_destroy_display(m_display);
-        al_destroy_bitmap(m_osr_buffer);
-        al_destroy_event_queue(m_event_queue);
-    }
-
-    // CefRenderHandler interface
-    void RenderHandler::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect &rect)
-    {
-        rect = CefRect(0, 0, al_get_display_width(m_display), al_get_display_height(m_display));
-    }
+        // once the bitmap holds the view again
+        if (m_ui_repaint && ui_fits && m_browser_host)
+        {
+            m_browser_host->Invalidate(PET_VIEW);
+            m_ui_repaint = false;
+        }
 
-    void RenderHandler::OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList &dirtyRects, const void *buffer, int width, int height)
-    {
+        // a hidden popup is gone, the next one must not show its contents before it painted.
+        // Showing or hiding discards the popup mailbox, so a frame of the old popup the pacer never took is dropped
+        // and one uploaded before the switch no longer matches the mailbox epoch.
+        if (!m_popup_visible || m_popup_epoch != m_popup_mailbox.epoch())
+        {
+            m_popup_width = 0;
+            m_popup_height = 0;
+        }
+        timings.upload = lap(stage_start, "OSR upload");
 
-        if (dirtyRects.size() != 1)
+        // al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+        if (m_ui_width > 0 && m_ui_height > 0)
+        {
+            al_draw_bitmap_region(m_osr_buffer, 0, 0, std::min(m_ui_width, view_width), std::min(m_ui_height, view_height), 0, 0, 0);
+        }
+        if (m_popup_width > 0 && m_popup_height > 0)
         {
-            // unclear how the buffer is organized when more than 1 rect needs to be redrawn
+            al_draw_bitmap_region(m_popup_buffer, 0, 0, m_popup_width, m_popup_height, m_popup_x, m_popup_y, 0);
+        }
+        timings.draw_ui = lap(stage_start, "al_draw_bitmap");
 
-            DLOG(FATAL) << "redrawing " << dirtyRects.size() << " rects, which is not yet implemented";
+        // blocks until vblank when vsync is on
+        if (m_display)
+        {
+            al_flip_display();
         }
+        timings.flip = lap(stage_start, "al_flip_display");
 
-        // convert buffer format to BGRA to RGBA
-        auto buffer_rgba = new uint8_t[width * height * 4];
-        memset(buffer_rgba, 0, width * height * 4);
+        Startup::mark(Startup::FirstFrame);
+        if (m_ui_shown)
+        {
+            Startup::mark(Startup::FirstUiFrame);
+        }
 
-        for (int i = 0; i < width * height; i++)
+        // the UI frame is on screen now, same clock as the allegro input timestamps
+        if (m_latency_probe)
         {
+            m_latency_probe->presented(m_ui_marker, al_get_time());
+        }
 
-            buffer_rgba[i * 4 + 0] = ((uint8_t *)buffer)[i * 4 + 3];
-            buffer_rgba[i * 4 + 1] = ((uint8_t *)buffer)[i * 4 + 0];
-            buffer_rgba[i * 4 + 2] = ((uint8_t *)buffer)[i * 4 + 1];
-            buffer_rgba[i * 4 + 3] = ((uint8_t *)buffer)[i * 4 + 2];
+        m_frame_timings = timings;
+    }
 
-            /*
-            B  -> A
-            G  -> R
-            R  -> G
-            A  -> B
+    void RenderHandler::applyRenderableCommands()
+    {
+        RenderableCommand command;
+        while (m_renderable_commands.pop(command))
+        {
+            if (!command.remove)
+            {
+                m_renderables.push_back(std::move(command.renderable));
+                continue;
+            }
 
-            */
+            auto found = std::find(m_renderables.begin(), m_renderables.end(), command.renderable);
+            if (found != m_renderables.end())
+            {
+                m_renderables.erase(found);
+            }
         }
+    }
+
+    void RenderHandler::attachMessagePump(ALLEGRO_EVENT_SOURCE *pump_event_source)
+    {
+        al_register_event_source(m_event_queue, pump_event_source);
+    }
 
-        m_l_osr_buffer_lock.lock();
+    void RenderHandler::setBrowserHost(CefRefPtr<CefBrowserHost> browser_host)
+    {
+        m_browser_host = browser_host;
+        applyFrameRates();
+    }
 
-#if FULL_REDRAW
-        // DLOG(INFO) << "Full  redraw";
+    void RenderHandler::setFrameRateListener(std::function<void(int)> listener)
+    {
+        std::lock_guard<std::mutex> lock(m_frame_rate_listener_mutex);
+        m_frame_rate_listener = std::move(listener);
+    }
 
-        const int size = width * height * 4;
+    void RenderHandler::applyFrameRates()
+    {
+        al_set_timer_speed(m_timer, m_frame_pacer.budget());
 
-        auto locked_region = al_lock_bitmap(m_osr_buffer, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_WRITEONLY);
-        if (!locked_region)
+        const int ui_fps = m_frame_pacer.uiFps();
+        if (m_browser_host)
         {
-            DLOG(FATAL) << "Failed to lock bitmap";
-            exit(1);
+            m_browser_host->SetWindowlessFrameRate(ui_fps);
+        }
+
+        std::lock_guard<std::mutex> lock(m_frame_rate_listener_mutex);
+        if (m_frame_rate_listener)
+        {
+            m_frame_rate_listener(ui_fps);
         }
+    }
+
+    void RenderHandler::schedulePumpWork(int64_t delay_ms)
+    {
+        // a new request replaces any pending one
+        m_pump_deadline = al_get_time() + std::max<int64_t>(delay_ms, 0) / 1000.0;
+    }
 
-        // Data copied in is in format BGRA
-        // paint the region in a random color
+    // CefRenderHandler interface
+    void RenderHandler::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect &rect)
+    {
+        rect = CefRect(0, 0, getViewWidth(), getViewHeight());
+    }
 
-        memcpy(locked_region->data, (void *)((size_t)buffer_rgba), size);
+    void RenderHandler::OnPaint(CefRefPtr<CefBrowser> browser, PaintElementType type, const RectList &dirtyRects, const void *buffer, int width, int height)
+    {
+        TRACE_SPAN("OnPaint");
+        auto paint_start = std::chrono::steady_clock::now();
+        m_paint_count.fetch_add(1, std::memory_order_relaxed);
+        Startup::mark(Startup::FirstPaint);
 
-        m_l_osr_buffer_lock.unlock();
+#if FULL_REDRAW
+        std::vector<CefRect> damage = {CefRect(0, 0, width, height)};
 #else
-        for (auto rect : dirtyRects)
+        std::vector<CefRect> damage(dirtyRects.begin(), dirtyRects.end());
+#endif
+
+        // converts into a staging buffer and hands it to the render loop, never blocks on it.
+        // Popups are painted popup sized, they go through their own mailbox and never touch the view.
+        if (type == PET_POPUP)
+        {
+            m_popup_mailbox.publish(buffer, width, height, std::move(damage));
+        }
+        else
         {
-            // TODO create the correct color buffer here and only for as large as the dirty rect needs it
-            const size_t offset = (rect.y * width + rect.x) * 4;
-            const int size = rect.width * rect.height * 4;
+            const uint32_t marker = m_latency_probe ? LatencyProbe::decode(buffer, width, height) : LatencyProbe::NO_MARKER;
+            m_frame_mailbox.publish(buffer, width, height, std::move(damage), marker);
+        }
+        m_frame_scheduler.invalidate(DAMAGE_UI_FRAME);
 
-            DLOG(INFO) << "dirty Rect: " << rect.x << " " << rect.y << " " << rect.width << " " << rect.height << " " << width << " " << height;
+        m_frame_pacer.addPaintCost(std::chrono::duration<double>(std::chrono::steady_clock::now() - paint_start).count());
+    }
+
+    void RenderHandler::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show)
+    {
+        // the view underneath was never painted over, hiding is just not drawing the popup anymore.
+        // Either way the popup changes, nothing painted before may be drawn for the next one.
+        m_popup_mailbox.discard();
+        m_popup_visible = show;
+        m_frame_scheduler.invalidate(DAMAGE_UI_FRAME);
+    }
+
+    void RenderHandler::OnPopupSize(CefRefPtr<CefBrowser> browser, const CefRect &rect)
+    {
+        // in view coordinates, the size arrives with the popup's paints
+        m_popup_x = rect.x;
+        m_popup_y = rect.y;
+        m_frame_scheduler.invalidate(DAMAGE_UI_FRAME);
+    }
+
+    size_t RenderHandler::uploadFrame(ALLEGRO_BITMAP *bitmap, const StagingFrame &frame)
+    {
+        size_t bytes = 0;
+
+        // stale frames are dropped before, this only guards against a bitmap that failed to grow
+        const CefRect bounds(0, 0,
+                             std::min(frame.width, al_get_bitmap_width(bitmap)),
+                             std::min(frame.height, al_get_bitmap_height(bitmap)));
+
+        for (const auto &dirty : frame.damage)
+        {
+            const CefRect rect = DirtyRects::intersect(dirty, bounds);
+            if (rect.width <= 0 || rect.height <= 0)
+            {
+                continue;
+            }
 
-            // lock the region
-            auto locked_region = al_lock_bitmap_region(m_osr_buffer, rect.x, rect.y, rect.width, rect.height, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_WRITEONLY);
+            // only the dirty region gets locked and uploaded
+            auto locked_region = al_lock_bitmap_region(bitmap, rect.x, rect.y, rect.width, rect.height, m_osr_format, ALLEGRO_LOCK_WRITEONLY);
             if (!locked_region)
             {
                 DLOG(FATAL) << "Failed to lock region"
@@ -237,16 +802,16 @@ namespace WUI
                 exit(1);
             }
 
-            // Data copied in is in format BGRA
-            // paint the region in a random color
+            // staging rows are `pitch` apart, destination rows by the lock pitch (may be negative)
+            PixelConvert::copy((uint8_t *)locked_region->data, locked_region->pitch,
+                               frame.pixels.data() + rect.y * frame.pitch + rect.x * 4, frame.pitch,
+                               rect.width, rect.height);
 
-            memcpy(locked_region->data, (void *)((size_t)buffer_rgba + offset), size);
-
-            m_l_osr_buffer_lock.unlock();
+            al_unlock_bitmap(bitmap);
+            bytes += (size_t)rect.width * rect.height * 4;
         }
-#endif
 
-        al_unlock_bitmap(m_osr_buffer);
+        return bytes;
     }
 
     // CefBase interface
@@ -261,6 +826,8 @@ namespace WUI
         DLOG(INFO) << ("[Renderer] shutting down");
 
         m_running = false;
+        // wake the loop in case it is idle
+        m_frame_scheduler.invalidate(DAMAGE_EXPOSE);
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "Resources/AppScheme.hpp"
+
+#include <include/base/cef_logging.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace WUI
+{
+    namespace
+    {
+        int hexDigit(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+        // app://ui/css/main%20dark.css?v=2#top -> css/main dark.css
+        std::string packPath(const std::string &url)
+        {
+            const size_t origin = strlen(APP_ORIGIN);
+            if (url.compare(0, origin, APP_ORIGIN) != 0)
+            {
+                return "";
+            }
+
+            const std::string path = url.substr(origin, url.find_first_of("?#", origin) - origin);
+
+            std::string decoded;
+            for (size_t i = 0; i < path.size(); i++)
+            {
+                int high, low;
+                if (path[i] == '%' && i + 2 < path.size() && (high = hexDigit(path[i + 1])) >= 0 && (low = hexDigit(path[i + 2])) >= 0)
+                {
+                    decoded += (char)(high * 16 + low);
+                    i += 2;
+                }
+                else
+                {
+                    decoded += path[i];
+                }
+            }
+
+            if (decoded.empty() || decoded.back() == '/')
+            {
+                decoded += "index.html";
+            }
+            return decoded;
+        }
+    }
+
+    void registerAppScheme(CefRawPtr<CefSchemeRegistrar> registrar)
+    {
+        // standard: relative urls, origins and storage behave like https; secure: no mixed content warnings
+        registrar->AddCustomScheme(APP_SCHEME, CEF_SCHEME_OPTION_STANDARD | CEF_SCHEME_OPTION_SECURE |
+                                                   CEF_SCHEME_OPTION_CORS_ENABLED | CEF_SCHEME_OPTION_FETCH_ENABLED);
+    }
+
+    bool installAppScheme(const std::string &pack_path)
+    {
+        auto pack = std::make_shared<ResourcePack>();
+        if (!pack->open(pack_path))
+        {
+            DLOG(WARNING) << "[Resources] no resource pack at " << pack_path;
+            return false;
+        }
+
+        DLOG(INFO) << "[Resources] serving " << pack->count() << " files from " << pack_path << " as " << APP_ORIGIN;
+        return CefRegisterSchemeHandlerFactory(APP_SCHEME, "", new AppSchemeHandlerFactory(pack));
+    }
+
+    CefRefPtr<CefResourceHandler> AppSchemeHandlerFactory::Create(CefRefPtr<CefBrowser> browser, CefRefPtr<CefFrame> frame, const CefString &scheme_name, CefRefPtr<CefRequest> request)
+    {
+        return new PackResourceHandler(m_pack, m_pack->find(packPath(request->GetURL().ToString())));
+    }
+
+    bool PackResourceHandler::Open(CefRefPtr<CefRequest> request, bool &handle_request, CefRefPtr<CefCallback> callback)
+    {
+        // everything is in memory already, answer right away
+        handle_request = true;
+        return true;
+    }
+
+    void PackResourceHandler::GetResponseHeaders(CefRefPtr<CefResponse> response, int64_t &response_length, CefString &redirectUrl)
+    {
+        if (!m_resource)
+        {
+            response->SetStatus(404);
+            response->SetStatusText("Not Found");
+            response->SetMimeType("text/plain");
+            response_length = 0;
+            return;
+        }
+
+        response->SetStatus(200);
+        response->SetStatusText("OK");
+        response->SetMimeType(m_resource->mime_type);
+        if (m_resource->gzip)
+        {
+            response->SetHeaderByName("Content-Encoding", "gzip", true);
+        }
+        response_length = (int64_t)m_resource->size;
+    }
+
+    bool PackResourceHandler::Skip(int64_t bytes_to_skip, int64_t &bytes_skipped, CefRefPtr<CefResourceSkipCallback> callback)
+    {
+        const size_t size = m_resource ? m_resource->size : 0;
+        const size_t skip = std::min<size_t>((size_t)bytes_to_skip, size - m_offset);
+
+        m_offset += skip;
+        bytes_skipped = (int64_t)skip;
+        return skip > 0;
+    }
+
+    bool PackResourceHandler::Read(void *data_out, int bytes_to_read, int &bytes_read, CefRefPtr<CefResourceReadCallback> callback)
+    {
+        const size_t size = m_resource ? m_resource->size : 0;
+        const size_t count = std::min<size_t>((size_t)bytes_to_read, size - m_offset);
+
+        // zero bytes with false ends the response
+        bytes_read = (int)count;
+        if (!count)
+        {
+            return false;
+        }
+
+        memcpy(data_out, m_resource->data + m_offset, count);
+        m_offset += count;
+        return true;
+    }
+}
@@ -0,0 +1,253 @@
+#include "Resources/ResourcePack.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WUI
+{
+    namespace
+    {
+        const char MAGIC[] = "WUIPAK 1\n";
+
+        struct MimeType
+        {
+            const char *extension;
+            const char *type;
+        };
+
+        const MimeType MIME_TYPES[] = {
+            {"html", "text/html"},
+            {"htm", "text/html"},
+            {"js", "text/javascript"},
+            {"mjs", "text/javascript"},
+            {"css", "text/css"},
+            {"json", "application/json"},
+            {"svg", "image/svg+xml"},
+            {"png", "image/png"},
+            {"jpg", "image/jpeg"},
+            {"jpeg", "image/jpeg"},
+            {"gif", "image/gif"},
+            {"webp", "image/webp"},
+            {"ico", "image/x-icon"},
+            {"woff", "font/woff"},
+            {"woff2", "font/woff2"},
+            {"ttf", "font/ttf"},
+            {"otf", "font/otf"},
+            {"wasm", "application/wasm"},
+            {"txt", "text/plain"},
+        };
+    }
+
+    ResourcePack::~ResourcePack()
+    {
+        close();
+    }
+
+    bool ResourcePack::open(const std::string &path)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        if (!mapping)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        m_file = file;
+        m_file_mapping = mapping;
+        m_size = (size_t)size.QuadPart;
+        m_mapping = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void *mapping = MAP_FAILED;
+        if (fstat(file, &info) == 0 && info.st_size > 0)
+        {
+            mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        }
+        // the mapping keeps the file alive on its own
+        ::close(file);
+
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_size = (size_t)info.st_size;
+        m_mapping = (const uint8_t *)mapping;
+
+        // the page loads most of it right away
+        madvise(mapping, m_size, MADV_WILLNEED);
+#endif
+
+        if (!m_mapping || !parseIndex())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void ResourcePack::close()
+    {
+        m_resources.clear();
+
+#ifdef _WIN32
+        if (m_mapping)
+        {
+            UnmapViewOfFile(m_mapping);
+        }
+        if (m_file_mapping)
+        {
+            CloseHandle(m_file_mapping);
+        }
+        if (m_file)
+        {
+            CloseHandle(m_file);
+        }
+        m_file = m_file_mapping = nullptr;
+#else
+        if (m_mapping)
+        {
+            munmap((void *)m_mapping, m_size);
+        }
+#endif
+
+        m_mapping = nullptr;
+        m_size = 0;
+    }
+
+    bool ResourcePack::parseIndex()
+    {
+        const size_t magic_length = sizeof(MAGIC) - 1;
+        if (m_size < magic_length || memcmp(m_mapping, MAGIC, magic_length) != 0)
+        {
+            return false;
+        }
+
+        // the index ends with an empty line, the data follows
+        const char *begin = (const char *)m_mapping;
+        const char *end = begin + m_size;
+        const char *line = begin + magic_length;
+
+        struct Line
+        {
+            uint64_t offset, size;
+            bool gzip;
+            std::string path;
+        };
+        std::vector<Line> lines;
+
+        for (;;)
+        {
+            const char *line_end = (const char *)memchr(line, '\n', end - line);
+            if (!line_end)
+            {
+                return false;
+            }
+            if (line_end == line)
+            {
+                line++;
+                break;
+            }
+
+            // <offset> <size> <encoding> <path>, the path may contain spaces
+            const std::string text(line, line_end);
+            char *cursor;
+            Line entry;
+            entry.offset = strtoull(text.c_str(), &cursor, 10);
+            entry.size = strtoull(cursor, &cursor, 10);
+            while (*cursor == ' ')
+            {
+                cursor++;
+            }
+            const char *encoding = cursor;
+            const char *space = strchr(encoding, ' ');
+            if (!space)
+            {
+                return false;
+            }
+            entry.gzip = std::string(encoding, space) == "gzip";
+            entry.path = space + 1;
+            lines.push_back(std::move(entry));
+
+            line = line_end + 1;
+        }
+
+        const uint8_t *data = (const uint8_t *)line;
+        const size_t data_size = end - line;
+        for (auto &entry : lines)
+        {
+            if (entry.offset > data_size || entry.size > data_size - entry.offset)
+            {
+                return false;
+            }
+
+            PackedResource resource;
+            resource.data = data + entry.offset;
+            resource.size = (size_t)entry.size;
+            resource.mime_type = mimeType(entry.path);
+            resource.gzip = entry.gzip;
+            m_resources[std::move(entry.path)] = resource;
+        }
+        return true;
+    }
+
+    const PackedResource *ResourcePack::find(const std::string &path) const
+    {
+        auto resource = m_resources.find(path);
+        return resource != m_resources.end() ? &resource->second : nullptr;
+    }
+
+    const char *ResourcePack::mimeType(const std::string &path)
+    {
+        const size_t dot = path.rfind('.');
+        if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+        {
+            return "application/octet-stream";
+        }
+
+        std::string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                       { return (char)std::tolower(c); });
+
+        for (const auto &mime : MIME_TYPES)
+        {
+            if (extension == mime.extension)
+            {
+                return mime.type;
+            }
+        }
+        return "application/octet-stream";
+    }
+}
@@ -0,0 +1,71 @@
+#include "TraceSession.hpp"
+#include "util/trace.hpp"
+
+#include <allegro5/allegro.h>
+#include <include/base/cef_logging.h>
+#include <include/cef_app.h>
+
+#include <cstdio>
+
+namespace WUI
+{
+    // give up on CEF's half of the trace after this long and write ours alone
+    static const double END_TRACING_TIMEOUT = 5.0;
+
+    TraceSession::TraceSession(const std::string &path)
+        : m_path(path)
+    {
+    }
+
+    void TraceSession::begin()
+    {
+        Trace::syncClock(CefNowFromSystemTraceTime());
+        Trace::start();
+
+        // empty category filter = CEF's defaults
+        if (!CefBeginTracing(CefString(), nullptr))
+        {
+            DLOG(WARNING) << "[Trace] CEF tracing unavailable, recording engine spans only";
+        }
+    }
+
+    void TraceSession::end()
+    {
+        Trace::stop();
+
+        // an empty path lets CEF pick a temporary file, OnEndTracingComplete merges it
+        if (CefEndTracing(CefString(), this))
+        {
+            const double deadline = al_get_time() + END_TRACING_TIMEOUT;
+            while (!m_written && al_get_time() < deadline)
+            {
+                CefDoMessageLoopWork();
+                al_rest(0.005);
+            }
+        }
+
+        if (!m_written)
+        {
+            DLOG(WARNING) << "[Trace] no CEF trace received, writing engine spans only";
+            Trace::write(m_path);
+            m_written = true;
+        }
+        DLOG(INFO) << "[Trace] written to " << m_path;
+    }
+
+    void TraceSession::OnEndTracingComplete(const CefString &tracing_file)
+    {
+        if (m_written)
+        {
+            return;
+        }
+
+        const std::string cef_trace = tracing_file.ToString();
+        if (!Trace::write(m_path, cef_trace))
+        {
+            DLOG(WARNING) << "[Trace] failed to write " << m_path;
+        }
+        std::remove(cef_trace.c_str());
+        m_written = true;
+    }
+}
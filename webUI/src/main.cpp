@@ -10,8 +10,13 @@
  */
 
 #include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_x.h>
+#include <allegro5/allegro_primitives.h>
 
 #ifdef ALLEGRO_WINDOWS
 #include <allegro5/allegro_windows.h>
@@ -23,25 +28,147 @@
 
 #include <include/cef_client.h>
 
+#include "BrowserApp.hpp"
+#include "Bench/Bench.hpp"
+#include "Bench/DataChannelBench.hpp"
 #include "BrowserClient.hpp"
-#include "Objects/Ball.hpp"
 #include "Input/InputManager.hpp"
+#include "Input/LatencyProbe.hpp"
+#include "Resources/AppScheme.hpp"
+#include "TraceSession.hpp"
+#include "util/startup_report.hpp"
 
-const float FPS = 60;
-
+CefRefPtr<WUI::BrowserApp> app;
 CefRefPtr<WUI::RenderHandler> renderHandler;
 CefRefPtr<CefBrowser> browser;
 CefRefPtr<WUI::BrowserClient> browserClient;
+CefRefPtr<WUI::TraceSession> traceSession;
+std::unique_ptr<WUI::LatencyProbe> latencyProbe;
+std::atomic<int> clickedBalls{0}; // added minus removed by clicks, shown by the page
+
+// centre of #increment while html/index.html runs with #latency
+static const vec2i LATENCY_BUTTON = {96, 36};
+
+// how long a scripted run waits for the page before it gives up and quits
+static const auto SCRIPT_READY_TIMEOUT = std::chrono::seconds(30);
+
+// Scripted runs drive the app from their own threads. Main sets this once the render loop ended and joins them
+// before anything they use goes away.
+static std::atomic<bool> scriptsStopping{false};
+static std::thread dataBenchThread; // started with the browser, main thread only
+
+// false as soon as main wants the scripted runs to end
+static bool scriptSleep(std::chrono::milliseconds duration)
+{
+	const auto until = std::chrono::steady_clock::now() + duration;
+	while (!scriptsStopping)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= until)
+		{
+			return true;
+		}
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, std::chrono::milliseconds(10)));
+	}
+	return false;
+}
+
+// ends the app from a scripted run, like esc
+static void scriptDone()
+{
+	renderHandler->shutdown();
+	WUI::InputManager::instance()->shutdown();
+}
+
+// CreateBrowser is asynchronous, everything that talks to the browser is wired up here (UI thread)
+static void attachBrowser(CefRefPtr<CefBrowser> created, int data_bench_floats)
+{
+	browser = created;
+
+	WUI::InputManager::instance(browser->GetHost());
+	WUI::InputManager::instance()->set_latency_probe(latencyProbe.get());
+
+	// mouse moves and bus batches go out once per UI frame, at whatever rate the pacer settles on
+	renderHandler->setFrameRateListener([](int fps)
+										{
+		WUI::InputManager::instance()->set_ui_frame_rate(fps);
+		browserClient->getBus()->setFrameRate(fps); });
+	renderHandler->setBrowserHost(browser->GetHost());
+
+	browserClient->getBus()->setBrowser(browser);
+	browserClient->getData()->setBrowser(browser);
+
+	// esc shutdown
+	WUI::InputManager::instance()->subscribe_key(ALLEGRO_KEY_ESCAPE, [](const ALLEGRO_EVENT &)
+												 {
+		DLOG(INFO) << "Shutting down";
+		renderHandler->shutdown();
+		WUI::InputManager::instance()->shutdown(); });
+
+	// click listener, right button
+	WUI::InputManager::instance()->subscribe_mouse_button(2, [](const ALLEGRO_EVENT &event)
+														  {
+		const vec2i pos = {event.mouse.x, event.mouse.y};
+
+		// a click on a ball removes it, anywhere else adds one
+		auto picked = renderHandler->pickBall(pos.x, pos.y);
+		if (picked.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+			return; // simulation stopped
+
+		auto ball = picked.get();
+		if (ball.valid())
+		{
+			DLOG(INFO) << "Removing ball at " << pos.x << ", " << pos.y;
+			renderHandler->removeBall(ball);
+			browserClient->getBus()->set("engine.balls", WUI::Bus::Value::of(--clickedBalls));
+		}
+		else
+		{
+			DLOG(INFO) << "Adding ball at " << pos.x << ", " << pos.y;
+			renderHandler->spawnBall(pos.x, pos.y);
+			browserClient->getBus()->set("engine.balls", WUI::Bus::Value::of(++clickedBalls));
+		} });
+
+	if (data_bench_floats && !scriptsStopping)
+	{
+		// subscribed before the page loads, it cannot say it is ready before anyone listens
+		auto bench = std::make_shared<WUI::DataChannelBench>(browserClient->getData(), browserClient->getBus(), browser, data_bench_floats);
+		dataBenchThread = std::thread([bench]() -> void
+									  {
+			const double ready_timeout = std::chrono::duration<double>(SCRIPT_READY_TIMEOUT).count();
+			if (bench->run(5, renderHandler->getUiFrameRate(), ready_timeout, scriptsStopping))
+			{
+				bench->report(stdout);
+			}
+			else if (!scriptsStopping)
+			{
+				DLOG(ERROR) << "[DataBench] the page never said it was ready, nothing measured";
+			}
+
+			if (!scriptsStopping)
+			{
+				scriptDone();
+			} });
+	}
+}
 
 int main(int argc, char *argv[])
 {
+	WUI::Startup::begin();
+
+	// offline pipeline benchmark, no browser involved
+	if (WUI::Bench::requested(argc, argv))
+	{
+		return WUI::Bench::run(argc, argv);
+	}
+
 	CefMainArgs args(argc, argv);
 
+	app = new WUI::BrowserApp();
+
 	{
 
-		int result = CefExecuteProcess(args, nullptr, nullptr);
-		// checkout CefApp, derive it and set it as second parameter, for more control on
-		// command args and resources.
+		int result = CefExecuteProcess(args, app, nullptr);
 		if (result >= 0) // child proccess has endend, so exit.
 		{
 			exit(result);
@@ -51,6 +178,83 @@ int main(int argc, char *argv[])
 			// we are here in the father proccess.
 		}
 	}
+	WUI::Startup::mark(WUI::Startup::SubprocessCheck);
+
+	WUI::RenderSettings render_settings;
+	int latency_clicks = 0; // scripted clicks, 0 = measure real input only
+	int data_bench_floats = 0;
+	bool use_file_ui = false;
+	std::string trace_path;
+	std::string startup_report; // "-" = stdout
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		// present in sync with the display refresh instead of as soon as a frame is ready
+		render_settings.vsync |= arg == "--vsync";
+
+		// --trace=file.json, frame stage spans merged with CEF's trace, open in chrome://tracing
+		if (arg.rfind("--trace=", 0) == 0)
+		{
+			trace_path = arg.substr(8);
+		}
+
+		// --latency: input to photon histogram on exit, --latency-script[=N]: click the page N times and exit
+		if (arg == "--latency" || arg.rfind("--latency-script", 0) == 0)
+		{
+			latencyProbe = std::make_unique<WUI::LatencyProbe>();
+		}
+		if (arg.rfind("--latency-script", 0) == 0)
+		{
+			latency_clicks = arg.size() > 17 ? std::max(1, atoi(arg.c_str() + 17)) : 200;
+		}
+
+		// --ui=file: load html/ from disk instead of the resource pack, to compare
+		use_file_ui |= arg == "--ui=file";
+
+		// --data-bench[=floats]: shared memory against ExecuteJavaScript for a float array per frame, then exit
+		if (arg.rfind("--data-bench", 0) == 0)
+		{
+			data_bench_floats = arg.size() > 13 ? std::max(1, atoi(arg.c_str() + 13)) : 65536;
+		}
+
+		// --startup-report[=file]: startup phase timings on exit, to stdout without a file
+		if (arg.rfind("--startup-report", 0) == 0)
+		{
+			startup_report = arg.size() > 17 ? arg.substr(17) : "-";
+		}
+	}
+
+	// both drive the page through its URL fragment, it can only run one of them
+	if (latencyProbe && data_bench_floats)
+	{
+		fprintf(stderr, "--latency and --data-bench cannot be combined, run them one at a time\n");
+		return 1;
+	}
+
+	// allegro has to be up before CEF starts posting pump events
+	al_init();
+	al_init_primitives_addon();
+
+	// init renderer and display, while CEF starts its processes; both take a while
+	auto createDisplay = [&render_settings]()
+	{
+		WUI::Startup::mark(WUI::Startup::DisplayStarted);
+		renderHandler = new WUI::RenderHandler(render_settings);
+		WUI::Startup::mark(WUI::Startup::DisplayCreated);
+	};
+
+#ifdef ALLEGRO_MACOSX
+	// cocoa creates windows on the main thread only
+	createDisplay();
+	std::thread display_thread;
+#else
+	std::thread display_thread([&]() -> void
+							   {
+		createDisplay();
+		// release the display's context, renderLoop makes it current on the main thread
+		al_set_target_bitmap(nullptr); });
+#endif
 
 	{
 		CefSettings settings;
@@ -67,14 +271,14 @@ int main(int argc, char *argv[])
 
 		settings.log_severity = LOGSEVERITY_INFO;
 		settings.windowless_rendering_enabled = true;
+		// CEF tells the app when to call CefDoMessageLoopWork, see BrowserApp::OnScheduleMessagePumpWork
+		settings.external_message_pump = true;
 
 #if !defined(CEF_USE_SANDBOX)
 		settings.no_sandbox = true;
 #endif
 
-		// init custom scheme for local files
-
-		bool result = CefInitialize(args, settings, nullptr, nullptr);
+		bool result = CefInitialize(args, settings, app, nullptr);
 
 		// CefInitialize creates a sub-proccess and executes the same executeable, as calling CefInitialize, if not set different in settings.browser_subprocess_path
 		// if you create an extra program just for the childproccess you only have to call CefExecuteProcess(...) in it.
@@ -84,17 +288,34 @@ int main(int argc, char *argv[])
 			exit(-2);
 		}
 	}
+	WUI::Startup::mark(WUI::Startup::CefInitialized);
+
+	if (!trace_path.empty())
+	{
+		traceSession = new WUI::TraceSession(trace_path);
+		traceSession->begin();
+	}
+
+	if (display_thread.joinable())
+	{
+		display_thread.join();
+	}
+	WUI::Startup::mark(WUI::Startup::DisplayReady);
 
-	// init renderer and display
+	renderHandler->attachMessagePump(app->getPumpEventSource());
+	renderHandler->setLatencyProbe(latencyProbe.get());
 
-	renderHandler = new WUI::RenderHandler();
-	std::string current_dir = "";
+	// next to the executable, wherever it was started from
+	std::string resources_dir = "";
 	{
-		auto charp = al_get_current_directory();
-		current_dir = std::string(charp) + "/";
-		free(charp);
+		ALLEGRO_PATH *resources = al_get_standard_path(ALLEGRO_RESOURCES_PATH);
+		resources_dir = al_path_cstr(resources, ALLEGRO_NATIVE_PATH_SEP);
+		al_destroy_path(resources);
 	}
 
+	// the page comes out of ui.pak as app://ui/, loose files in html/ only with --ui=file or without a pack
+	const bool packed_ui = !use_file_ui && WUI::installAppScheme(resources_dir + "ui.pak");
+
 	// create browser-window
 
 	{
@@ -102,52 +323,153 @@ int main(int argc, char *argv[])
 		window_info.SetAsWindowless(0); // false means no transparency (site background colour)
 
 		browserClient = new WUI::BrowserClient(renderHandler);
+		browserClient->onBrowserCreated([data_bench_floats](CefRefPtr<CefBrowser> created)
+										{ attachBrowser(created, data_bench_floats); });
+
+		// page <-> engine events, batched to one message per UI frame; held back until the browser exists
+		auto bus = browserClient->getBus();
+		bus->setFrameRate(renderHandler->getUiFrameRate());
+
+		// the increment button drops a ball in, the page shows how many balls its clicks added
+		bus->subscribe("ui.increment", [](const WUI::Bus::Value &)
+					   {
+			renderHandler->spawnBall(100 + rand() % 400, 100);
+			browserClient->getBus()->set("engine.balls", WUI::Bus::Value::of(++clickedBalls)); });
 
 		CefBrowserSettings browserSettings;
-		browserSettings.windowless_frame_rate = 60; // 30 is default
+		browserSettings.windowless_frame_rate = renderHandler->getUiFrameRate(); // 30 is default, paced by the renderer from here on
 
-		auto path = "file://" + current_dir + "html/index.html";
+		std::string path = packed_ui ? std::string(WUI::APP_ORIGIN) + "index.html" : "file://" + resources_dir + "html/index.html";
+		if (latencyProbe)
+		{
+			path += "#latency"; // the page shows its click marker
+		}
+		else if (data_bench_floats)
+		{
+			path += "#databench"; // the page acks every array it reads
+		}
 
-		browser = CefBrowserHost::CreateBrowserSync(window_info, browserClient.get(), path, browserSettings, nullptr, nullptr);
+		// returns right away, the render loop draws the game until the page is there (attachBrowser)
+		WUI::Startup::mark(WUI::Startup::BrowserRequested);
+		if (!CefBrowserHost::CreateBrowser(window_info, browserClient.get(), path, browserSettings, nullptr, nullptr))
+		{
+			DLOG(FATAL) << "Failed to create the browser";
+			exit(-3);
+		}
+	}
 
-		WUI::InputManager::instance(browser->GetHost());
+	// scripted latency run: left clicks on the increment button through the real input path, then quit
+	std::thread latency_thread;
+	if (latency_clicks)
+	{
+		latency_thread = std::thread([=]() -> void
+									 {
+			// the page has to be up and showing its marker, clicks before that would not be counted
+			const auto deadline = std::chrono::steady_clock::now() + SCRIPT_READY_TIMEOUT;
+			while (!latencyProbe->ready())
+			{
+				if (std::chrono::steady_clock::now() > deadline)
+				{
+					DLOG(ERROR) << "[Latency] the page never showed its marker, no clicks sent";
+					scriptDone();
+					return;
+				}
+				if (!scriptSleep(std::chrono::milliseconds(50)))
+				{
+					return;
+				}
+			}
+
+			for (int i = 0; i < latency_clicks; i++)
+			{
+				ALLEGRO_EVENT event = {};
+				event.mouse.x = LATENCY_BUTTON.x;
+				event.mouse.y = LATENCY_BUTTON.y;
+				event.mouse.button = 1;
+
+				event.type = ALLEGRO_EVENT_MOUSE_BUTTON_DOWN;
+				WUI::InputManager::instance()->inject(event);
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				event.type = ALLEGRO_EVENT_MOUSE_BUTTON_UP;
+				WUI::InputManager::instance()->inject(event);
+
+				// off the frame grid, so clicks land all over the frame interval
+				if (!scriptSleep(std::chrono::milliseconds(80 + rand() % 17)))
+				{
+					return;
+				}
+			}
+
+			// let the last one reach the screen
+			if (scriptSleep(std::chrono::milliseconds(500)))
+			{
+				scriptDone();
+			} });
+	}
 
-		// esc shutdown
-		std::thread([=]() -> void
-					{
-                  WUI::InputManager::instance()->wait_for_key(ALLEGRO_KEY_ESCAPE);
-				  	DLOG(INFO) << "Shutting down";
-					renderHandler->shutdown();
-				  WUI::InputManager::instance()->shutdown();
+	renderHandler->renderLoop();
 
-                  exit(0); })
-			.detach();
+	// closed or esc'd while a scripted run was still going, it must not touch input, the bus or CEF from here on
+	scriptsStopping = true;
+	if (latency_thread.joinable())
+	{
+		latency_thread.join();
+	}
+	if (dataBenchThread.joinable())
+	{
+		dataBenchThread.join();
+	}
 
-		// click listener
+	if (latencyProbe)
+	{
+		latencyProbe->report(stdout);
+	}
+
+	if (browser)
+	{
+		// how much mouse traffic the coalescing kept away from CEF
+		const auto stats = WUI::InputManager::instance()->get_stats();
+		DLOG(INFO) << "[Input] mouse moves " << stats.moves_received << " received, " << stats.moves_forwarded << " forwarded; "
+				   << "wheel " << stats.wheel_received << " received, " << stats.wheel_forwarded << " forwarded; "
+				   << renderHandler->getPaintCount() << " paints";
+	}
 
-		std::thread([=]() -> void
-					{
-                  while (true)
-                  {
-                    vec2i pos;
-                    auto ok = WUI::InputManager::instance()->wait_for_mouse_button(2, pos);
-                    if (!ok)
-                      return;
-                  
-					// add a ball to the manager
-					DLOG(INFO) << "Adding ball at " << pos.x << ", " << pos.y;
+	{
+		const auto resize = renderHandler->getResizeStats();
+		DLOG(INFO) << "[Renderer] " << resize.resizes << " resizes, " << resize.osr_reallocations << " OSR and "
+				   << resize.staging_reallocations << " staging reallocations, " << resize.stale_frames << " stale frames dropped; "
+				   << (resize.osr_bytes + resize.staging_bytes) / (1024 * 1024) << " MB of UI buffers";
+	}
 
-					renderHandler->addObject(std::make_shared<WUI::Ball>(pos.x, pos.y));
-                  } })
-			.detach();
+	DLOG(INFO) << "[Startup] first frame " << WUI::Startup::at(WUI::Startup::FirstFrame) << " ms, first UI frame "
+			   << WUI::Startup::at(WUI::Startup::FirstUiFrame) << " ms after main(), page from " << (packed_ui ? "app://" : "file://");
+	if (startup_report == "-")
+	{
+		WUI::Startup::report(stdout);
+	}
+	else if (!startup_report.empty())
+	{
+		if (FILE *out = fopen(startup_report.c_str(), "w"))
+		{
+			WUI::Startup::report(out);
+			fclose(out);
+		}
 	}
 
-	renderHandler->renderLoop();
+	DLOG(INFO) << "[Bus] " << browserClient->getBus()->getEventsSent() << " events in "
+			   << browserClient->getBus()->getMessagesSent() << " messages to the page";
+
+	if (traceSession)
+	{
+		traceSession->end();
+		traceSession = nullptr;
+	}
 
 	{
 		browser = nullptr;
 		browserClient = nullptr;
 		CefShutdown();
+		app = nullptr;
 	}
 
 	return 0;
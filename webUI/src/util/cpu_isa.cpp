@@ -0,0 +1,93 @@
+#include "util/cpu_isa.hpp"
+
+#include <atomic>
+
+#if WUI_X86 && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace WUI
+{
+    bool isaSupported(Isa isa)
+    {
+#if WUI_X86 && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        switch (isa)
+        {
+        case Isa::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+        default:
+            return true;
+        }
+#elif WUI_X86 && defined(_MSC_VER)
+        int info[4];
+        switch (isa)
+        {
+        case Isa::SSSE3:
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        case Isa::AVX2:
+        {
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }
+        default:
+            return true;
+        }
+#else
+        return isa == Isa::Scalar;
+#endif
+    }
+
+    const char *isaName(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::SSSE3:
+            return "SSSE3";
+        case Isa::AVX2:
+            return "AVX2";
+        default:
+            return "scalar";
+        }
+    }
+
+    // -1 until the first bestIsa(). CEF builds with -fno-threadsafe-statics, so a function local static would
+    // have no guard. Lazily picked state in this tree lives at namespace scope instead, racing first callers
+    // store the same value.
+    static std::atomic<int> g_best_isa{-1};
+
+    static Isa detectBestIsa()
+    {
+        if (isaSupported(Isa::AVX2))
+        {
+            return Isa::AVX2;
+        }
+        if (isaSupported(Isa::SSSE3))
+        {
+            return Isa::SSSE3;
+        }
+        return Isa::Scalar;
+    }
+
+    Isa bestIsa()
+    {
+        int isa = g_best_isa.load(std::memory_order_relaxed);
+        if (isa < 0)
+        {
+            isa = (int)detectBestIsa();
+            g_best_isa.store(isa, std::memory_order_relaxed);
+        }
+        return (Isa)isa;
+    }
+}
@@ -0,0 +1,67 @@
+#include "util/dispatch_pool.hpp"
+#include "util/trace.hpp"
+
+#include <algorithm>
+
+namespace WUI
+{
+    DispatchPool::DispatchPool(unsigned threads)
+    {
+        for (unsigned index = 0; index < std::max(threads, 1u); index++)
+        {
+            m_workers.push_back(std::make_unique<Worker>());
+            Worker &worker = *m_workers.back();
+            worker.thread = std::thread(&DispatchPool::run, std::ref(worker));
+        }
+    }
+
+    DispatchPool::~DispatchPool()
+    {
+        for (auto &worker : m_workers)
+        {
+            {
+                std::lock_guard<std::mutex> guard(worker->lock);
+                worker->stop = true;
+            }
+            worker->wake.notify_one();
+        }
+
+        for (auto &worker : m_workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    void DispatchPool::post(uint64_t key, std::function<void()> job)
+    {
+        Worker &worker = *m_workers[key % m_workers.size()];
+        {
+            std::lock_guard<std::mutex> guard(worker.lock);
+            worker.jobs.push_back(std::move(job));
+        }
+        worker.wake.notify_one();
+    }
+
+    void DispatchPool::run(Worker &worker)
+    {
+        Trace::setThreadName("event dispatch");
+
+        std::unique_lock<std::mutex> guard(worker.lock);
+        while (true)
+        {
+            worker.wake.wait(guard, [&]
+                             { return worker.stop || !worker.jobs.empty(); });
+            if (worker.jobs.empty())
+            {
+                return; // stopped and drained
+            }
+
+            std::function<void()> job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+
+            guard.unlock();
+            job();
+            guard.lock();
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#include "util/startup_report.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace WUI
+{
+    namespace Startup
+    {
+        namespace
+        {
+            typedef std::chrono::steady_clock Clock;
+
+            Clock::time_point s_main;
+            std::atomic<int64_t> s_marks[PHASES]; // ns since main() + 1, 0 = not reached
+            double s_process_start_ms = -1;
+
+            const char *const NAMES[PHASES] = {
+                "main entered",
+                "subprocess check",
+                "display started",
+                "CEF initialized",
+                "display created",
+                "display ready",
+                "browser requested",
+                "browser created",
+                "first frame",
+                "first OnPaint",
+                "load end",
+                "first UI frame",
+            };
+
+#ifdef __linux__
+            // field 22 of /proc/self/stat is the start time in clock ticks since boot, same base as CLOCK_BOOTTIME
+            double readProcessStartMs()
+            {
+                FILE *stat = fopen("/proc/self/stat", "r");
+                if (!stat)
+                {
+                    return -1;
+                }
+
+                char buffer[1024];
+                const size_t length = fread(buffer, 1, sizeof(buffer) - 1, stat);
+                fclose(stat);
+                buffer[length] = 0;
+
+                // the command name may contain spaces, fields are counted after its closing parenthesis
+                const char *field = nullptr;
+                for (size_t i = length; i > 0; i--)
+                {
+                    if (buffer[i - 1] == ')')
+                    {
+                        field = buffer + i;
+                        break;
+                    }
+                }
+
+                unsigned long long start_ticks = 0;
+                if (!field || sscanf(field, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+                {
+                    return -1;
+                }
+
+                timespec boot;
+                clock_gettime(CLOCK_BOOTTIME, &boot);
+                const double now_ms = boot.tv_sec * 1000.0 + boot.tv_nsec / 1e6;
+                return now_ms - start_ticks * 1000.0 / sysconf(_SC_CLK_TCK);
+            }
+#endif
+        }
+
+        void begin()
+        {
+            s_main = Clock::now();
+#ifdef __linux__
+            s_process_start_ms = readProcessStartMs();
+#endif
+            mark(MainEntered);
+        }
+
+        void mark(Phase phase)
+        {
+            if (s_marks[phase].load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            const int64_t since_main = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_main).count();
+            int64_t expected = 0;
+            s_marks[phase].compare_exchange_strong(expected, since_main + 1);
+        }
+
+        double at(Phase phase)
+        {
+            const int64_t mark = s_marks[phase].load();
+            return mark ? (mark - 1) / 1e6 : -1;
+        }
+
+        double processStartMs()
+        {
+            return s_process_start_ms;
+        }
+
+        void report(FILE *out)
+        {
+            fprintf(out, "startup report, ms since main()\n");
+            if (s_process_start_ms >= 0)
+            {
+                // tick resolution, usually 10 ms
+                fprintf(out, "  %-20s %10.1f\n", "process spawn", -s_process_start_ms);
+            }
+
+            double previous = 0;
+            for (int phase = 0; phase < PHASES; phase++)
+            {
+                const double time = at((Phase)phase);
+                if (time < 0)
+                {
+                    fprintf(out, "  %-20s %10s\n", NAMES[phase], "-");
+                    continue;
+                }
+
+                // the display phases run beside CEF, their step is measured from their own start
+                const double step = phase == DisplayCreated && at(DisplayStarted) >= 0 ? time - at(DisplayStarted) : time - previous;
+                fprintf(out, "  %-20s %10.1f  (+%.1f)\n", NAMES[phase], time, step);
+                if (phase != DisplayStarted && phase != DisplayCreated)
+                {
+                    previous = time;
+                }
+            }
+
+            const double spawn = s_process_start_ms >= 0 ? s_process_start_ms : 0;
+            if (at(FirstFrame) >= 0)
+            {
+                fprintf(out, "  time to first frame    %.1f ms\n", spawn + at(FirstFrame));
+            }
+            if (at(FirstUiFrame) >= 0)
+            {
+                fprintf(out, "  time to first UI frame %.1f ms\n", spawn + at(FirstUiFrame));
+            }
+        }
+    }
+}
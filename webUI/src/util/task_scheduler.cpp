@@ -0,0 +1,163 @@
+#include "util/task_scheduler.hpp"
+#include "util/trace.hpp"
+
+#include <algorithm>
+
+namespace WUI
+{
+    static uint64_t packRange(uint64_t begin, uint64_t end)
+    {
+        return end << 32 | begin;
+    }
+
+    static uint64_t rangeBegin(uint64_t range)
+    {
+        return range & 0xffffffffu;
+    }
+
+    static uint64_t rangeEnd(uint64_t range)
+    {
+        return range >> 32;
+    }
+
+    TaskScheduler::TaskScheduler(unsigned threads)
+    {
+        m_thread_count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        m_runs.reset(new Run[m_thread_count]);
+
+        // run 0 belongs to whichever thread calls parallelFor
+        for (unsigned index = 1; index < m_thread_count; index++)
+        {
+            m_workers.emplace_back(&TaskScheduler::workerLoop, this, index);
+        }
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_wake_lock);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (auto &worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    // not a function local static, see g_best_isa in cpu_isa.cpp
+    static std::once_flag s_instance_once;
+    static std::unique_ptr<TaskScheduler> s_instance;
+
+    TaskScheduler &TaskScheduler::instance()
+    {
+        std::call_once(s_instance_once, []()
+                       { s_instance = std::make_unique<TaskScheduler>(); });
+        return *s_instance;
+    }
+
+    void TaskScheduler::run(size_t count, size_t grain, RangeFn fn, void *context)
+    {
+        grain = std::max<size_t>(grain, 1);
+        const uint64_t chunks = (count + grain - 1) / grain;
+
+        // nothing to split, or another loop owns the workers
+        if (chunks <= 1 || m_thread_count == 1 || m_busy.exchange(true, std::memory_order_acquire))
+        {
+            if (count)
+            {
+                fn(context, 0, count);
+            }
+            return;
+        }
+
+        m_fn = fn;
+        m_context = context;
+        m_count = count;
+        m_grain = grain;
+        m_pending.store(chunks, std::memory_order_relaxed);
+
+        // contiguous runs, a thread walks neighbouring chunks as long as nobody steals from it
+        for (unsigned index = 0; index < m_thread_count; index++)
+        {
+            m_runs[index].range.store(packRange(chunks * index / m_thread_count, chunks * (index + 1) / m_thread_count),
+                                      std::memory_order_release);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(m_wake_lock);
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        work(0);
+
+        // the last chunks may still be running on workers
+        while (m_pending.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        m_busy.store(false, std::memory_order_release);
+    }
+
+    void TaskScheduler::workerLoop(unsigned index)
+    {
+        Trace::setThreadName("task worker");
+
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> guard(m_wake_lock);
+                m_wake.wait(guard, [&]
+                            { return m_stop || m_generation != seen; });
+                if (m_stop)
+                {
+                    return;
+                }
+                seen = m_generation;
+            }
+
+            // A worker waking late may find the loop finished and the next one already published. Claiming
+            // from the current runs is right either way, the loop is read only after a successful claim.
+            work(index);
+        }
+    }
+
+    void TaskScheduler::work(unsigned index)
+    {
+        // own run from the front
+        std::atomic<uint64_t> &own = m_runs[index].range;
+        uint64_t range = own.load(std::memory_order_acquire);
+        while (rangeBegin(range) < rangeEnd(range))
+        {
+            if (own.compare_exchange_weak(range, packRange(rangeBegin(range) + 1, rangeEnd(range)), std::memory_order_acq_rel))
+            {
+                runChunk(rangeBegin(range));
+            }
+        }
+
+        // then the others' from the back, neighbours first
+        for (unsigned offset = 1; offset < m_thread_count; offset++)
+        {
+            std::atomic<uint64_t> &victim = m_runs[(index + offset) % m_thread_count].range;
+            range = victim.load(std::memory_order_acquire);
+            while (rangeBegin(range) < rangeEnd(range))
+            {
+                if (victim.compare_exchange_weak(range, packRange(rangeBegin(range), rangeEnd(range) - 1), std::memory_order_acq_rel))
+                {
+                    runChunk(rangeEnd(range) - 1);
+                }
+            }
+        }
+    }
+
+    void TaskScheduler::runChunk(uint64_t chunk)
+    {
+        const size_t begin = chunk * m_grain;
+        m_fn(m_context, begin, std::min(begin + m_grain, m_count));
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
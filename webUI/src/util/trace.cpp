@@ -0,0 +1,239 @@
+#include "util/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define WUI_GETPID _getpid
+#else
+#include <unistd.h>
+#define WUI_GETPID getpid
+#endif
+
+namespace WUI
+{
+    namespace Trace
+    {
+        std::atomic<bool> g_enabled{false};
+
+        namespace
+        {
+            struct Event
+            {
+                const char *name;
+                int64_t start;
+                int64_t end;
+            };
+
+            // relaxed atomics, the exporter reads slots while their owner may be rewriting them
+            struct Slot
+            {
+                std::atomic<const char *> name{nullptr};
+                std::atomic<int64_t> start{0};
+                std::atomic<int64_t> end{0};
+            };
+
+            // Written only by its owning thread. The writer bumps head after filling a slot, the exporter
+            // copies without locking and throws away whatever may have been overwritten meanwhile.
+            struct ThreadBuffer
+            {
+                static constexpr size_t CAPACITY = 1 << 15; // ~2 min of 8 spans per frame at 60 fps
+
+                Slot events[CAPACITY];
+                std::atomic<uint64_t> head{0};
+                uint32_t tid = 0;
+                std::string name; // guarded by s_registry_lock
+            };
+
+            // buffers outlive their threads, a thread that exited still shows up in the trace
+            std::mutex s_registry_lock;
+            std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+            std::atomic<int64_t> s_clock_offset_us{0};
+
+            thread_local ThreadBuffer *t_buffer = nullptr;
+            thread_local const char *t_name = nullptr;
+
+            // buffers are only created once a thread records, threads that never trace cost nothing
+            ThreadBuffer &threadBuffer()
+            {
+                if (!t_buffer)
+                {
+                    std::lock_guard<std::mutex> guard(s_registry_lock);
+                    s_buffers.push_back(std::make_unique<ThreadBuffer>());
+                    t_buffer = s_buffers.back().get();
+                    t_buffer->tid = (uint32_t)s_buffers.size();
+                    t_buffer->name = t_name ? t_name : "";
+                }
+                return *t_buffer;
+            }
+
+            // names are string literals from our own code, only quotes and backslashes need care
+            void writeString(std::ostream &out, const std::string &text)
+            {
+                out << '"';
+                for (char c : text)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        out << '\\';
+                    }
+                    out << c;
+                }
+                out << '"';
+            }
+
+            void writeEvents(std::ostream &out, bool &first)
+            {
+                const int pid = WUI_GETPID();
+                const double offset_us = (double)s_clock_offset_us.load();
+
+                // microseconds since boot need more than the default 6 significant digits
+                out << std::fixed << std::setprecision(3);
+
+                std::lock_guard<std::mutex> guard(s_registry_lock);
+                for (const auto &buffer : s_buffers)
+                {
+                    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+                    const uint64_t begin = head > ThreadBuffer::CAPACITY ? head - ThreadBuffer::CAPACITY : 0;
+
+                    std::vector<Event> events;
+                    events.reserve(head - begin);
+                    for (uint64_t i = begin; i < head; i++)
+                    {
+                        const Slot &slot = buffer->events[i % ThreadBuffer::CAPACITY];
+                        events.push_back({slot.name.load(std::memory_order_relaxed),
+                                          slot.start.load(std::memory_order_relaxed),
+                                          slot.end.load(std::memory_order_relaxed)});
+                    }
+
+                    // The owner kept recording while we copied, drop the slots it may have reused. Pairs with the
+                    // fence in record(): if we saw any write of event n, head_after is at least n. Event head_after
+                    // itself may be half written, so its slot (index head_after - CAPACITY) goes too.
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    const uint64_t head_after = buffer->head.load(std::memory_order_relaxed);
+                    const uint64_t valid = head_after + 1 > ThreadBuffer::CAPACITY ? head_after + 1 - ThreadBuffer::CAPACITY : 0;
+                    const size_t skip = valid > begin ? (size_t)std::min<uint64_t>(valid - begin, events.size()) : 0;
+
+                    out << (first ? "\n" : ",\n");
+                    first = false;
+                    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                        << ",\"args\":{\"name\":";
+                    writeString(out, buffer->name.empty() ? "thread " + std::to_string(buffer->tid) : buffer->name);
+                    out << "}}";
+
+                    for (size_t i = skip; i < events.size(); i++)
+                    {
+                        const Event &event = events[i];
+                        out << ",\n{\"name\":";
+                        writeString(out, event.name);
+                        out << ",\"cat\":\"wui\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                            << ",\"ts\":" << event.start / 1000.0 + offset_us
+                            << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+                    }
+                }
+            }
+        }
+
+        int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void start()
+        {
+            g_enabled.store(true, std::memory_order_relaxed);
+        }
+
+        void stop()
+        {
+            g_enabled.store(false, std::memory_order_relaxed);
+        }
+
+        void syncClock(int64_t reference_now_us)
+        {
+            s_clock_offset_us = reference_now_us - now() / 1000;
+        }
+
+        void setThreadName(const char *name)
+        {
+            t_name = name;
+            if (t_buffer)
+            {
+                std::lock_guard<std::mutex> guard(s_registry_lock);
+                t_buffer->name = name;
+            }
+        }
+
+        void record(const char *name, int64_t start_ns, int64_t end_ns)
+        {
+            ThreadBuffer &buffer = threadBuffer();
+            const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+            // head is published before the slot is touched, an exporter that reads these stores also sees it
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Slot &slot = buffer.events[head % ThreadBuffer::CAPACITY];
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.start.store(start_ns, std::memory_order_relaxed);
+            slot.end.store(end_ns, std::memory_order_relaxed);
+            buffer.head.store(head + 1, std::memory_order_release);
+        }
+
+        bool write(const std::string &path, const std::string &merge_with)
+        {
+            std::string merged;
+            size_t insert_at = std::string::npos;
+
+            if (!merge_with.empty())
+            {
+                std::ifstream in(merge_with, std::ios::binary);
+                std::stringstream contents;
+                contents << in.rdbuf();
+                merged = contents.str();
+
+                // {"traceEvents":[ ... ], ...}, our events go first in that array
+                const size_t key = merged.find("\"traceEvents\"");
+                if (key != std::string::npos)
+                {
+                    insert_at = merged.find('[', key);
+                }
+            }
+
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+
+            bool first = true;
+            if (insert_at != std::string::npos)
+            {
+                out.write(merged.data(), insert_at + 1);
+                writeEvents(out, first);
+
+                // keep a separator if CEF recorded anything itself
+                const size_t next = merged.find_first_not_of(" \t\r\n", insert_at + 1);
+                if (!first && next != std::string::npos && merged[next] != ']')
+                {
+                    out << ",";
+                }
+                out.write(merged.data() + insert_at + 1, merged.size() - insert_at - 1);
+            }
+            else
+            {
+                out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+                writeEvents(out, first);
+                out << "\n]}\n";
+            }
+
+            return (bool)out;
+        }
+    }
+}